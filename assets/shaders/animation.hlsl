@@ -0,0 +1,147 @@
+struct Track {
+    uint timestamp_offset;
+    uint value_offset;
+    uint key_count;
+    uint interpolation;
+    float sample_rate;
+    uint3 padding;
+};
+
+struct SkeletonJoint {
+    float4 rotation;
+    float4 translation;
+    float4 scale;
+    uint parent;
+    uint depth;
+    uint output;
+    uint rotation_track;
+    uint translation_track;
+    uint scale_track;
+    uint2 padding;
+    float4x4 inverse_bind;
+};
+
+struct PushConstants {
+    uint animation_buffer_index;
+    uint track_offset;
+    uint timestamp_offset;
+    uint value_offset;
+    float seek_time;
+    uint skeleton_buffer_index;
+    uint skeleton_offset;
+    uint joint_count;
+    uint max_depth;
+    uint root_buffer_index;
+    uint root_offset;
+    uint pose_buffer_index;
+    uint pose_offset;
+    uint joint_buffer_index;
+    uint joint_buffer_offset;
+};
+
+static const uint NO_TRACK = 0xffffffff;
+static const uint INTERPOLATION_STEP = 1;
+static const uint INTERPOLATION_CUBIC_SPLINE = 2;
+
+[[vk::push_constant]] ConstantBuffer<PushConstants> push_constants: register(b0, space0);
+[[vk::binding(0, 0)]] RWByteAddressBuffer bindless_buffers[]: register(u1);
+[[vk::binding(0, 1)]] Texture2D<float4> bindless_textures[]: register(t2);
+[[vk::binding(0, 2)]] SamplerState bindless_samplers[]: register(t3);
+
+float load_timestamp(uint index) {
+    return bindless_buffers[push_constants.animation_buffer_index].Load<float>(push_constants.timestamp_offset + 4 * index);
+}
+
+float4 load_value(uint index) {
+    return bindless_buffers[push_constants.animation_buffer_index].Load<float4>(push_constants.value_offset + 16 * index);
+}
+
+float4 sample_track(uint track_index, float4 rest, bool rotation) {
+    if (track_index == NO_TRACK) return rest;
+    Track track = bindless_buffers[push_constants.animation_buffer_index].Load<Track>(push_constants.track_offset + 32 * track_index);
+    float seek_time = push_constants.seek_time;
+
+    uint previous = 0;
+    float t = 0.0;
+    if (track.key_count > 1) {
+        if (track.sample_rate > 0.0) {
+            float position = max(seek_time * track.sample_rate, 0.0);
+            previous = min(uint(position), track.key_count - 1);
+            t = previous + 1 < track.key_count ? position - previous : 0.0;
+        } else if (seek_time >= load_timestamp(track.timestamp_offset + track.key_count - 1)) {
+            previous = track.key_count - 1;
+        } else if (seek_time > load_timestamp(track.timestamp_offset)) {
+            uint low = 0;
+            uint high = track.key_count - 1;
+            while (high - low > 1) {
+                uint middle = (low + high) / 2;
+                if (load_timestamp(track.timestamp_offset + middle) <= seek_time) {
+                    low = middle;
+                } else {
+                    high = middle;
+                }
+            }
+            previous = low;
+            float previous_time = load_timestamp(track.timestamp_offset + low);
+            t = (seek_time - previous_time) / (load_timestamp(track.timestamp_offset + low + 1) - previous_time);
+        }
+    }
+
+    if (track.interpolation == INTERPOLATION_CUBIC_SPLINE) {
+        uint c = track.value_offset + 4 * previous;
+        float4 value = ((load_value(c + 3) * t + load_value(c + 2)) * t + load_value(c + 1)) * t + load_value(c);
+        return rotation ? normalize(value) : value;
+    }
+
+    float4 a = load_value(track.value_offset + previous);
+    if (track.interpolation == INTERPOLATION_STEP || t == 0.0) return a;
+    float4 b = load_value(track.value_offset + previous + 1);
+    if (rotation) {
+        if (dot(a, b) < 0.0) b = -b;
+        return normalize(lerp(a, b, t));
+    }
+    return lerp(a, b, t);
+}
+
+float4x4 compose_transform(float3 translation, float4 q, float3 scale) {
+    float3x3 rotation = float3x3(
+        1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y - q.w * q.z), 2.0 * (q.x * q.z + q.w * q.y),
+        2.0 * (q.x * q.y + q.w * q.z), 1.0 - 2.0 * (q.x * q.x + q.z * q.z), 2.0 * (q.y * q.z - q.w * q.x),
+        2.0 * (q.x * q.z - q.w * q.y), 2.0 * (q.y * q.z + q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y)
+    );
+    return float4x4(
+        rotation[0] * scale, translation.x,
+        rotation[1] * scale, translation.y,
+        rotation[2] * scale, translation.z,
+        0.0, 0.0, 0.0, 1.0
+    );
+}
+
+// One group poses one skeleton. Joints are composed one hierarchy level at a time so every parent
+// pose is in the pose buffer before its children read it.
+[numthreads(64, 1, 1)]
+void cs_animate(uint3 thread_id: SV_GroupThreadID) {
+    for (uint level = 0; level <= push_constants.max_depth; level++) {
+        for (uint j = thread_id.x; j < push_constants.joint_count; j += 64) {
+            SkeletonJoint joint = bindless_buffers[push_constants.skeleton_buffer_index].Load<SkeletonJoint>(push_constants.skeleton_offset + 144 * j);
+            if (joint.depth != level) continue;
+
+            float4 rotation = sample_track(joint.rotation_track, joint.rotation, true);
+            float4 translation = sample_track(joint.translation_track, joint.translation, false);
+            float4 scale = sample_track(joint.scale_track, joint.scale, false);
+            float4x4 local = compose_transform(translation.xyz, rotation, scale.xyz);
+
+            float4x4 parent;
+            if (joint.parent < push_constants.joint_count) {
+                parent = bindless_buffers[push_constants.pose_buffer_index].Load<float4x4>(64 * (push_constants.pose_offset + joint.parent));
+            } else {
+                parent = bindless_buffers[push_constants.root_buffer_index].Load<float4x4>(64 * (push_constants.root_offset + joint.parent - push_constants.joint_count));
+            }
+            float4x4 global = mul(parent, local);
+
+            bindless_buffers[push_constants.pose_buffer_index].Store<float4x4>(64 * (push_constants.pose_offset + j), global);
+            bindless_buffers[push_constants.joint_buffer_index].Store<float4x4>(64 * (push_constants.joint_buffer_offset + joint.output), mul(global, joint.inverse_bind));
+        }
+        DeviceMemoryBarrierWithGroupSync();
+    }
+}
@@ -0,0 +1,59 @@
+struct Vertex {
+    float4 position;
+    float4 normal;
+    float2 uv;
+    float2 padding;
+    uint4 joints;
+    float4 weights;
+};
+
+struct MorphVertex {
+    uint vertex;
+    uint delta_offset;
+    uint delta_count;
+    uint padding;
+};
+
+struct MorphDelta {
+    float3 position;
+    uint target;
+    float3 normal;
+    float padding;
+};
+
+struct PushConstants {
+    uint morph_buffer_index;
+    uint morph_vertex_offset;
+    uint morph_vertex_count;
+    uint delta_offset;
+    uint vertex_buffer_index;
+    uint vertex_buffer_offset;
+    uint output_buffer_index;
+    uint output_buffer_offset;
+    uint weight_buffer_index;
+    uint weight_offset;
+};
+
+[[vk::push_constant]] ConstantBuffer<PushConstants> push_constants: register(b0, space0);
+[[vk::binding(0, 0)]] RWByteAddressBuffer bindless_buffers[]: register(u1);
+[[vk::binding(0, 1)]] Texture2D<float4> bindless_textures[]: register(t2);
+[[vk::binding(0, 2)]] SamplerState bindless_samplers[]: register(t3);
+
+// One thread per vertex moved by any morph target. The vertex is rebuilt from the base mesh and its
+// weighted deltas, so vertices no target touches are never read or written.
+[numthreads(64, 1, 1)]
+void cs_morph(uint3 thread_id: SV_DispatchThreadID) {
+    if (thread_id.x >= push_constants.morph_vertex_count) return;
+
+    MorphVertex record = bindless_buffers[push_constants.morph_buffer_index].Load<MorphVertex>(16 * (push_constants.morph_vertex_offset + thread_id.x));
+    Vertex vertex = bindless_buffers[push_constants.vertex_buffer_index].Load<Vertex>(80 * (push_constants.vertex_buffer_offset + record.vertex));
+    for (uint d = 0; d < record.delta_count; d++) {
+        MorphDelta delta = bindless_buffers[push_constants.morph_buffer_index].Load<MorphDelta>(push_constants.delta_offset + 32 * (record.delta_offset + d));
+        float weight = bindless_buffers[push_constants.weight_buffer_index].Load<float>(4 * (push_constants.weight_offset + delta.target));
+        vertex.position.xyz += weight * delta.position;
+        vertex.normal.xyz += weight * delta.normal;
+    }
+    vertex.normal.xyz = normalize(vertex.normal.xyz);
+
+    bindless_buffers[push_constants.output_buffer_index].Store<Vertex>(80 * (push_constants.output_buffer_offset + record.vertex), vertex);
+}
@@ -19,8 +19,9 @@ struct Light {
     float3 padding;
 };
 
+// The top three rows of an affine matrix; the bottom row is always (0, 0, 0, 1).
 struct Transform {
-    float4x4 transform;
+    float4 rows[3];
 };
 
 struct PushConstants {
@@ -30,20 +31,44 @@ struct PushConstants {
     uint transform_buffer_offset;
     uint light_buffer_index;
     uint light_buffer_offset;
+    uint vertex_animation_texture;
+    uint vertex_animation_vertex_count;
+    uint vertex_animation_frame_count;
+    float vertex_animation_frame;
 };
 
+// Must match VERTEX_ANIMATION_TEXTURE_WIDTH in the render plugin.
+static const uint VERTEX_ANIMATION_TEXTURE_WIDTH = 4096;
+
 [[vk::push_constant]] ConstantBuffer<PushConstants> push_constants: register(b0, space0);
 [[vk::binding(0, 0)]] ByteAddressBuffer bindless_buffers[]: register(t1);
 [[vk::binding(0, 1)]] Texture2D<float4> bindless_textures[]: register(t2);
 [[vk::binding(0, 2)]] SamplerState bindless_samplers[]: register(t3);
 
+float4 transform_point(Transform transform, float4 position) {
+    return float4(dot(transform.rows[0], position), dot(transform.rows[1], position), dot(transform.rows[2], position), position.w);
+}
+
+#ifdef VERTEX_ANIMATION
+// Same layout as in mesh.hlsl; only the position texel of each baked vertex is needed here.
+float4 load_animated_position(uint frame, uint vertex_id) {
+    uint texel = 2 * (frame * push_constants.vertex_animation_vertex_count + vertex_id);
+    return bindless_textures[push_constants.vertex_animation_texture].Load(int3(texel % VERTEX_ANIMATION_TEXTURE_WIDTH, texel / VERTEX_ANIMATION_TEXTURE_WIDTH, 0));
+}
+#endif
+
 PSInput VSMain(uint vertex_id: SV_VertexId) {
     Vertex vertex = bindless_buffers[push_constants.vertex_buffer_index].Load<Vertex>(80 * (push_constants.vertex_buffer_offset + vertex_id));
-    Transform transform = bindless_buffers[push_constants.transform_buffer_index].Load<Transform>(push_constants.transform_buffer_offset * 64);
+    Transform transform = bindless_buffers[push_constants.transform_buffer_index].Load<Transform>(push_constants.transform_buffer_offset * 48);
     Light light = bindless_buffers[push_constants.light_buffer_index].Load<Light>(push_constants.light_buffer_offset * 112);
 
-#ifndef MESH_SKINNING
-    vertex.position = mul(transform.transform, vertex.position);
+#if defined(VERTEX_ANIMATION)
+    uint frame = min(uint(push_constants.vertex_animation_frame), push_constants.vertex_animation_frame_count - 1);
+    uint next_frame = min(frame + 1, push_constants.vertex_animation_frame_count - 1);
+    vertex.position = lerp(load_animated_position(frame, vertex_id), load_animated_position(next_frame, vertex_id), frac(push_constants.vertex_animation_frame));
+    vertex.position = transform_point(transform, vertex.position);
+#elif !defined(MESH_SKINNING)
+    vertex.position = transform_point(transform, vertex.position);
 #endif
 
     vertex.position = mul(light.view_projection, vertex.position);
@@ -7,6 +7,11 @@ struct Vertex {
     float4 weights;
 };
 
+// The top three rows of an affine matrix; the bottom row is always (0, 0, 0, 1).
+struct Transform {
+    float4 rows[3];
+};
+
 struct PushConstants {
     uint vertex_count;
     uint vertex_buffer_index;
@@ -14,13 +19,22 @@ struct PushConstants {
     uint joint_buffer_index;
     uint joint_buffer_offset;
     uint output_buffer_index;
+    uint transform_buffer_index;
+    uint model_transform_offset;
+    uint output_buffer_offset;
 };
 
+static const uint NO_MODEL_TRANSFORM = 0xffffffff;
+
 [[vk::push_constant]] ConstantBuffer<PushConstants> push_constants: register(b0, space0);
 [[vk::binding(0, 0)]] RWByteAddressBuffer bindless_buffers[]: register(u1);
 [[vk::binding(0, 1)]] Texture2D<float4> bindless_textures[]: register(t2);
 [[vk::binding(0, 2)]] SamplerState bindless_samplers[]: register(t3);
 
+float4 transform_point(Transform transform, float4 position) {
+    return float4(dot(transform.rows[0], position), dot(transform.rows[1], position), dot(transform.rows[2], position), position.w);
+}
+
 float4x4 get_skin_matrix(Vertex vertex) {
     float4x4 joint0 = bindless_buffers[push_constants.joint_buffer_index].Load<float4x4>(64 * (push_constants.joint_buffer_offset + vertex.joints.x));
     float4x4 joint1 = bindless_buffers[push_constants.joint_buffer_index].Load<float4x4>(64 * (push_constants.joint_buffer_offset + vertex.joints.y));
@@ -40,6 +54,14 @@ void cs_skinning(uint3 thread_id: SV_DispatchThreadID) {
 
     float4x4 skin_matrix = get_skin_matrix(vertex);
     vertex.position = mul(skin_matrix, vertex.position);
+    // Normals have w = 0, so they only pick up the rotation and scale of each matrix.
+    vertex.normal = float4(normalize(mul(skin_matrix, vertex.normal).xyz), 0.0);
+    // Palettes from the pose cache are relative to the character root.
+    if (push_constants.model_transform_offset != NO_MODEL_TRANSFORM) {
+        Transform model = bindless_buffers[push_constants.transform_buffer_index].Load<Transform>(48 * push_constants.model_transform_offset);
+        vertex.position = transform_point(model, vertex.position);
+        vertex.normal = transform_point(model, vertex.normal);
+    }
 
-    bindless_buffers[push_constants.output_buffer_index].Store<Vertex>(80 * (push_constants.vertex_buffer_offset + vertex_id), vertex);
+    bindless_buffers[push_constants.output_buffer_index].Store<Vertex>(80 * (push_constants.output_buffer_offset + vertex_id), vertex);
 }
\ No newline at end of file
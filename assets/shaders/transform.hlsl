@@ -0,0 +1,61 @@
+struct HierarchyNode {
+    float3 translation;
+    uint parent;
+    float4 rotation;
+    float3 scale;
+    float padding;
+};
+
+// The top three rows of an affine matrix; the bottom row is always (0, 0, 0, 1).
+struct Transform {
+    float4 rows[3];
+};
+
+struct PushConstants {
+    uint hierarchy_buffer_index;
+    uint transform_buffer_index;
+    uint level_offset;
+    uint level_count;
+};
+
+static const uint NO_PARENT = 0xffffffff;
+
+[[vk::push_constant]] ConstantBuffer<PushConstants> push_constants: register(b0, space0);
+[[vk::binding(0, 0)]] RWByteAddressBuffer bindless_buffers[]: register(u1);
+[[vk::binding(0, 1)]] Texture2D<float4> bindless_textures[]: register(t2);
+[[vk::binding(0, 2)]] SamplerState bindless_samplers[]: register(t3);
+
+float4x4 compose_transform(float3 translation, float4 q, float3 scale) {
+    float3x3 rotation = float3x3(
+        1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y - q.w * q.z), 2.0 * (q.x * q.z + q.w * q.y),
+        2.0 * (q.x * q.y + q.w * q.z), 1.0 - 2.0 * (q.x * q.x + q.z * q.z), 2.0 * (q.y * q.z - q.w * q.x),
+        2.0 * (q.x * q.z - q.w * q.y), 2.0 * (q.y * q.z + q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y)
+    );
+    return float4x4(
+        rotation[0] * scale, translation.x,
+        rotation[1] * scale, translation.y,
+        rotation[2] * scale, translation.z,
+        0.0, 0.0, 0.0, 1.0
+    );
+}
+
+// One thread per node of a single hierarchy level. Levels are dispatched in order with a barrier
+// between them, so every parent's world matrix is in the transform buffer before its children read it.
+[numthreads(64, 1, 1)]
+void cs_propagate(uint3 thread_id: SV_DispatchThreadID) {
+    if (thread_id.x >= push_constants.level_count) return;
+
+    uint index = push_constants.level_offset + thread_id.x;
+    HierarchyNode node = bindless_buffers[push_constants.hierarchy_buffer_index].Load<HierarchyNode>(48 * index);
+    float4x4 world = compose_transform(node.translation, node.rotation, node.scale);
+    if (node.parent != NO_PARENT) {
+        Transform parent = bindless_buffers[push_constants.transform_buffer_index].Load<Transform>(48 * node.parent);
+        world = mul(float4x4(parent.rows[0], parent.rows[1], parent.rows[2], float4(0.0, 0.0, 0.0, 1.0)), world);
+    }
+
+    Transform result;
+    result.rows[0] = world[0];
+    result.rows[1] = world[1];
+    result.rows[2] = world[2];
+    bindless_buffers[push_constants.transform_buffer_index].Store<Transform>(48 * index, result);
+}
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+import stellar.assets.gltf;
+import stellar.core.result;
+
+// Reports the peak resident set size of importing one glTF file, memory mapped or, with --buffered,
+// read into a heap copy first. The peak is a high water mark of the whole process, so compare the
+// two modes in separate runs:
+//     GltfLoadBenchmark archer.glb
+//     GltfLoadBenchmark archer.glb --buffered
+size_t peak_rss_bytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <file.gltf|file.glb> [--buffered]\n", argv[0]);
+        return 1;
+    }
+    const bool buffered = argc > 2 && std::strcmp(argv[2], "--buffered") == 0;
+
+    const size_t before = peak_rss_bytes();
+    auto gltf = load_gltf(argv[1], GltfLoadOptions { .memory_map = !buffered });
+    if (gltf.is_err()) {
+        std::fprintf(stderr, "%s\n", gltf.unwrap_err().c_str());
+        return 1;
+    }
+    const size_t after = peak_rss_bytes();
+
+    constexpr double MIB = 1024.0 * 1024.0;
+    std::printf("%s: peak RSS %.1f MiB, %.1f MiB above the %.1f MiB before import\n",
+        buffered ? "buffered" : "mapped", after / MIB, (after - before) / MIB, before / MIB);
+    return 0;
+}
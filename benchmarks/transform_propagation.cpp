@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include "ecs/ecs.hpp"
+
+import stellar.scene.transform;
+
+// Times a synthetic scene shaped like a crowd of skeletons: ROOT_COUNT roots, each with a tree of
+// JOINT_COUNT joints, every joint getting a new rotation each frame like an animation pass writes.
+// The same scene runs once with whole Transforms and once split into Translation/Rotation/Scale.
+constexpr uint32_t ROOT_COUNT = 500;
+constexpr uint32_t JOINT_COUNT = 64;
+constexpr uint32_t WARMUP_FRAMES = 10;
+constexpr uint32_t FRAME_COUNT = 200;
+
+struct Timing {
+    double write_ms = 0.0;
+    double propagate_ms = 0.0;
+};
+
+void spawn_scene(const flecs::world& world, const bool split) {
+    const Transform local {
+        .translation = glm::vec3(0.0f, 1.0f, 0.0f),
+        .rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+        .scale = glm::vec3(1.0f)
+    };
+    for (uint32_t r = 0; r < ROOT_COUNT; r++) {
+        std::vector<flecs::entity> joints;
+        joints.reserve(JOINT_COUNT);
+        joints.push_back(world.entity().set<Transform>(local));
+        for (uint32_t j = 1; j < JOINT_COUNT; j++) {
+            // A binary tree, about as deep as a humanoid rig.
+            joints.push_back(world.entity().set<Transform>(local).child_of(joints[(j - 1) / 2]));
+        }
+        if (split) {
+            for (const flecs::entity joint: joints) {
+                split_transform(joint);
+            }
+        }
+    }
+}
+
+Timing run_scene(const bool split) {
+    flecs::world world;
+    initialize_transform_plugin(world);
+    spawn_scene(world, split);
+
+    auto transform_query = world.query<Transform>();
+    auto rotation_query = world.query<Rotation>();
+    Timing timing{};
+    for (uint32_t frame = 0; frame < WARMUP_FRAMES + FRAME_COUNT; frame++) {
+        const glm::quat rotation = glm::angleAxis(0.01f * frame, glm::vec3(0.0f, 0.0f, 1.0f));
+
+        const auto write_start = std::chrono::steady_clock::now();
+        if (split) {
+            rotation_query.each([&](Rotation& joint) { joint.value = rotation; });
+        } else {
+            transform_query.each([&](Transform& joint) { joint.rotation = rotation; });
+        }
+        const auto propagate_start = std::chrono::steady_clock::now();
+        world.progress();
+        const auto end = std::chrono::steady_clock::now();
+
+        if (frame < WARMUP_FRAMES) continue;
+        timing.write_ms += std::chrono::duration<double, std::milli>(propagate_start - write_start).count();
+        timing.propagate_ms += std::chrono::duration<double, std::milli>(end - propagate_start).count();
+    }
+    timing.write_ms /= FRAME_COUNT;
+    timing.propagate_ms /= FRAME_COUNT;
+    return timing;
+}
+
+int main() {
+    std::printf("%u hierarchies of %u joints, mean over %u frames\n", ROOT_COUNT, JOINT_COUNT, FRAME_COUNT);
+    for (const bool split: { false, true }) {
+        const Timing timing = run_scene(split);
+        std::printf("%-10s write %8.3f ms  propagate %8.3f ms\n", split ? "split" : "transform", timing.write_ms, timing.propagate_ms);
+    }
+    return 0;
+}
@@ -1,8 +1,18 @@
 module;
 
 #include <vector>
+#include <array>
 #include <variant>
 #include <optional>
+#include <unordered_set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/compatibility.hpp>
 #include "ecs/ecs.hpp"
@@ -12,6 +22,8 @@ module;
 export module stellar.animation;
 
 import stellar.scene.transform;
+import stellar.render.primitives;
+import stellar.core.result;
 
 export enum class Interpolation {
     Linear,
@@ -19,23 +31,39 @@ export enum class Interpolation {
     CubicSpline
 };
 
+// Cubic spline curves keep their in/out tangents next to the values; they are empty otherwise.
 export struct Keyframes {
     struct Rotation {
         std::vector<glm::quat> rotations;
+        std::vector<glm::quat> in_tangents;
+        std::vector<glm::quat> out_tangents;
     };
     struct Translation {
         std::vector<glm::vec3> translations;
+        std::vector<glm::vec3> in_tangents;
+        std::vector<glm::vec3> out_tangents;
     };
     struct Scale {
         std::vector<glm::vec3> scales;
+        std::vector<glm::vec3> in_tangents;
+        std::vector<glm::vec3> out_tangents;
     };
-    std::variant<Rotation, Translation, Scale> frames;
+    // Morph target weights, count per key. Cubic spline weights keep only their values and are
+    // played back linearly.
+    struct Weights {
+        std::vector<float> weights;
+        uint32_t count;
+    };
+    std::variant<Rotation, Translation, Scale, Weights> frames;
 };
 
+// A sample_rate above zero marks a curve whose key k sits at k / sample_rate.
 export struct AnimationCurve {
+    uint32_t joint_index;
     std::vector<float> keyframe_timestamps;
     Keyframes keyframes;
     Interpolation interpolation;
+    float sample_rate = 0.0f;
     
     std::optional<uint32_t> find_keyframe(float seek_time) const {
         if (keyframe_timestamps[0] >= seek_time) {
@@ -51,20 +79,670 @@ export struct AnimationCurve {
     }
 };
 
+// Only animated joints have curves; each curve names the skeleton joint it drives.
 export struct AnimationClip {
-    std::vector<std::vector<AnimationCurve>> curves;
+    std::vector<AnimationCurve> curves;
+    float duration;
+};
+
+export constexpr uint32_t NO_JOINT = std::numeric_limits<uint32_t>::max();
+
+// The joints of a rig, by name. Clips and AnimationTargets address joints by their index in this list
+// instead of by the node indices of the file they were imported from, so one copy of a clip drives
+// every character that shares the rig. Joints of unnamed nodes have an empty name and are never
+// found by name.
+export struct Skeleton {
+    std::vector<std::string> joint_names;
+
+    uint32_t find_joint(const std::string_view name) const {
+        if (name.empty()) return NO_JOINT;
+        const auto it = std::ranges::find(joint_names, name);
+        return it != joint_names.end() ? static_cast<uint32_t>(std::distance(joint_names.begin(), it)) : NO_JOINT;
+    }
+
+    uint32_t add_joint(std::string name) {
+        const uint32_t joint = find_joint(name);
+        if (joint != NO_JOINT) {
+            return joint;
+        }
+        joint_names.push_back(std::move(name));
+        return joint_names.size() - 1;
+    }
+
+    uint32_t add_unnamed_joint() {
+        joint_names.emplace_back();
+        return joint_names.size() - 1;
+    }
+};
+
+// Maps the node indices of one imported file to the joints of a skeleton. Nodes that are not part of
+// the skeleton map to NO_JOINT.
+export struct RetargetTable {
+    std::vector<uint32_t> joints;
+
+    uint32_t find_joint(const uint32_t node_index) const {
+        return node_index < joints.size() ? joints[node_index] : NO_JOINT;
+    }
+};
+
+// Matches the rig nodes of a file to skeleton joints by name; node_names holds the name of every rig
+// node and nothing for the others. With extend, names the skeleton does not know become new joints
+// and unnamed nodes get a joint of their own. Without it, every rig node must name a joint of the
+// skeleton, and unnamed nodes are an error since nothing ties them to a joint. Two rig nodes with the
+// same name are always an error: they would silently drive the same joint.
+export Result<RetargetTable, std::string> build_retarget_table(Skeleton& skeleton, std::span<const std::optional<std::string>> node_names, const bool extend) {
+    RetargetTable table;
+    table.joints.reserve(node_names.size());
+    std::unordered_set<std::string_view> seen;
+    for (size_t i = 0; i < node_names.size(); i++) {
+        if (!node_names[i].has_value()) {
+            table.joints.push_back(NO_JOINT);
+            continue;
+        }
+        const std::string& name = node_names[i].value();
+        if (name.empty()) {
+            if (!extend) {
+                return Err("Unnamed rig node " + std::to_string(i) + " cannot be matched to the skeleton");
+            }
+            table.joints.push_back(skeleton.add_unnamed_joint());
+            continue;
+        }
+        if (!seen.insert(name).second) {
+            return Err("Rig node name \"" + name + "\" is used by more than one node");
+        }
+        const uint32_t joint = extend ? skeleton.add_joint(name) : skeleton.find_joint(name);
+        if (joint == NO_JOINT) {
+            return Err("Rig node \"" + name + "\" has no joint in the skeleton");
+        }
+        table.joints.push_back(joint);
+    }
+    return Ok(std::move(table));
+}
+
+// Rewrites a clip imported with file node indices against the table's skeleton. Curves on nodes
+// without a joint are dropped.
+export AnimationClip retarget_animation_clip(AnimationClip clip, const RetargetTable& table) {
+    for (AnimationCurve& curve: clip.curves) {
+        curve.joint_index = table.find_joint(curve.joint_index);
+    }
+    std::erase_if(clip.curves, [](const AnimationCurve& curve) { return curve.joint_index == NO_JOINT; });
+    return clip;
+}
+
+export constexpr uint32_t NO_TRACK = std::numeric_limits<uint32_t>::max();
+
+// Tracks with a sample_rate have no timeline; their keys are found with floor(t * sample_rate).
+export struct PackedTrack {
+    uint32_t joint_index;
+    uint32_t timestamp_offset;
+    uint32_t value_offset;
+    uint32_t key_count;
+    Interpolation interpolation;
+    float sample_rate;
+};
+
+export struct JointTracks {
+    uint32_t joint_index;
+    uint32_t rotation = NO_TRACK;
+    uint32_t translation = NO_TRACK;
+    uint32_t scale = NO_TRACK;
+    uint32_t weights = NO_TRACK;
+};
+
+// Morph weights of one joint. The track's keys index into weights from weight_offset, weight_count
+// values per key; pose_offset is where the sampled weights land in AnimationPose::weights.
+export struct PackedWeightTrack {
+    PackedTrack track;
+    uint32_t weight_offset;
+    uint32_t weight_count;
+    uint32_t pose_offset;
+};
+
+// Smallest-three encoding of a unit quaternion in 48 bits. The largest component is dropped and
+// rebuilt from the unit length; the other three are stored as 15 bit fixed point in
+// [-1/sqrt(2), 1/sqrt(2)]. The top bits of the first two words hold the index of the dropped component.
+export struct QuantizedQuat {
+    uint16_t components[3];
+};
+
+constexpr float QUANTIZED_QUAT_SCALE = 32767.0f;
+
+export QuantizedQuat quantize_rotation(glm::quat rotation) {
+    rotation = glm::normalize(rotation);
+    const float c[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; i++) {
+        if (std::abs(c[i]) > std::abs(c[largest])) {
+            largest = i;
+        }
+    }
+    // q and -q are the same rotation, so flip the sign until the dropped component is positive.
+    const float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+    QuantizedQuat quantized{};
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        const float v = std::clamp(c[i] * sign * glm::root_two<float>(), -1.0f, 1.0f);
+        quantized.components[j++] = static_cast<uint16_t>(std::lround((v * 0.5f + 0.5f) * QUANTIZED_QUAT_SCALE));
+    }
+    quantized.components[0] |= (largest & 1) << 15;
+    quantized.components[1] |= (largest >> 1) << 15;
+    return quantized;
+}
+
+export glm::quat dequantize_rotation(const QuantizedQuat quantized) {
+    const uint32_t largest = (quantized.components[0] >> 15) | ((quantized.components[1] >> 15) << 1);
+    float c[4];
+    float sum = 0.0f;
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        const float v = ((quantized.components[j++] & 0x7fff) / QUANTIZED_QUAT_SCALE * 2.0f - 1.0f) * glm::one_over_root_two<float>();
+        c[i] = v;
+        sum += v * v;
+    }
+    c[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+    return glm::quat(c[3], c[0], c[1], c[2]);
+}
+
+// Tracks are ordered by interpolation: [0, step_begin) are linear, [step_begin, cubic_begin) are step
+// and the rest are cubic splines. Linear and step tracks index into values. Cubic tracks index into
+// coefficients, four per segment (c0, c1, c2, c3 of c3 * s^3 + c2 * s^2 + c1 * s + c0), with one
+// trailing constant segment holding the last key.
+export template<typename T, typename Key = T>
+struct PackedChannel {
+    std::vector<PackedTrack> tracks;
+    std::vector<Key> values;
+    std::vector<T> coefficients;
+    uint32_t step_begin = 0;
+    uint32_t cubic_begin = 0;
+
+    size_t memory_usage() const {
+        return tracks.size() * sizeof(PackedTrack) + values.size() * sizeof(Key) + coefficients.size() * sizeof(T);
+    }
+};
+
+// Runtime layout of an AnimationClip. Every track of a channel kind lives back to back in one array,
+// so sampling a clip walks a handful of contiguous buffers instead of one heap allocation per curve.
+// Tracks with identical keyframe times share one timeline in timestamps, and joint_tracks only lists
+// animated joints, sorted by joint index.
+export struct PackedAnimationClip {
+    std::vector<float> timestamps;
+    PackedChannel<glm::quat, QuantizedQuat> rotations;
+    PackedChannel<glm::vec3> translations;
+    PackedChannel<glm::vec3> scales;
+    std::vector<PackedWeightTrack> weight_tracks;
+    std::vector<float> weights;
+    std::vector<JointTracks> joint_tracks;
     float duration;
+
+    const JointTracks* find_joint_tracks(const uint32_t joint_index) const {
+        const auto it = std::ranges::lower_bound(joint_tracks, joint_index, {}, &JointTracks::joint_index);
+        if (it == joint_tracks.end() || it->joint_index != joint_index) {
+            return nullptr;
+        }
+        return &*it;
+    }
+
+    size_t memory_usage() const {
+        return timestamps.size() * sizeof(float)
+            + rotations.memory_usage()
+            + translations.memory_usage()
+            + scales.memory_usage()
+            + weight_tracks.size() * sizeof(PackedWeightTrack)
+            + weights.size() * sizeof(float)
+            + joint_tracks.size() * sizeof(JointTracks);
+    }
 };
 
+struct KeySample {
+    uint32_t previous;
+    uint32_t next;
+    float t;
+};
+
+export struct AnimationPose {
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::vec3> scales;
+    std::vector<float> weights;
+    std::vector<KeySample> samples;
+};
+
+// Index of the last keyframe at or before the previous sample time, per track. Playback only moves
+// forward between loops, so the next sample usually sits at the same key or a few keys later.
+export struct KeyframeCursors {
+    std::vector<uint32_t> rotations;
+    std::vector<uint32_t> translations;
+    std::vector<uint32_t> scales;
+    std::vector<uint32_t> weights;
+    float seek_time = 0.0f;
+    bool valid = false;
+};
+
+// Tracks at or below this many keys are searched with a branchless count instead of a binary search.
+constexpr uint32_t SMALL_TRACK_KEYS = 16;
+// A cursor walks at most this many keys forward before a binary search becomes cheaper.
+constexpr uint32_t MAX_CURSOR_STEPS = 8;
+
+template<typename T>
+T zero_value() {
+    if constexpr (std::is_same_v<T, glm::quat>) {
+        return glm::quat(0.0f, 0.0f, 0.0f, 0.0f);
+    } else {
+        return T(0.0f);
+    }
+}
+
+// Expands the Hermite form of every segment into polynomial coefficients in the normalized segment
+// time s, so evaluation is three multiply-adds per component.
+template<typename T>
+void pack_cubic_segments(
+    std::vector<T>& coefficients,
+    const std::vector<float>& timestamps,
+    const std::vector<T>& values,
+    const std::vector<T>& in_tangents,
+    const std::vector<T>& out_tangents
+) {
+    const T zero = zero_value<T>();
+    for (uint32_t k = 0; k + 1 < values.size(); k++) {
+        const float dt = timestamps[k + 1] - timestamps[k];
+        const T p0 = values[k];
+        const T p1 = values[k + 1];
+        const T m0 = out_tangents[k] * dt;
+        const T m1 = in_tangents[k + 1] * dt;
+        coefficients.push_back(p0);
+        coefficients.push_back(m0);
+        coefficients.push_back(p0 * -3.0f + p1 * 3.0f - m0 * 2.0f - m1);
+        coefficients.push_back(p0 * 2.0f - p1 * 2.0f + m0 + m1);
+    }
+    coefficients.push_back(values.back());
+    coefficients.push_back(zero);
+    coefficients.push_back(zero);
+    coefficients.push_back(zero);
+}
+
+// Appends a timeline to the clip, or reuses an identical one that is already there.
+uint32_t pack_timeline(PackedAnimationClip& packed, std::vector<std::pair<uint32_t, uint32_t>>& timelines, const std::vector<float>& timestamps) {
+    for (const auto& [offset, count]: timelines) {
+        if (count == timestamps.size() && std::equal(timestamps.begin(), timestamps.end(), packed.timestamps.begin() + offset)) {
+            return offset;
+        }
+    }
+    const uint32_t offset = packed.timestamps.size();
+    packed.timestamps.insert(packed.timestamps.end(), timestamps.begin(), timestamps.end());
+    timelines.emplace_back(offset, static_cast<uint32_t>(timestamps.size()));
+    return offset;
+}
+
+JointTracks& pack_joint_tracks(PackedAnimationClip& packed, const uint32_t joint_index) {
+    const auto it = std::ranges::lower_bound(packed.joint_tracks, joint_index, {}, &JointTracks::joint_index);
+    if (it != packed.joint_tracks.end() && it->joint_index == joint_index) {
+        return *it;
+    }
+    return *packed.joint_tracks.insert(it, JointTracks { .joint_index = joint_index });
+}
+
+template<typename K, typename T, typename Key>
+void pack_channel(
+    PackedAnimationClip& packed,
+    std::vector<std::pair<uint32_t, uint32_t>>& timelines,
+    PackedChannel<T, Key>& channel,
+    const AnimationClip& clip,
+    std::vector<T> K::* keys,
+    uint32_t JointTracks::* joint_track
+) {
+    for (const Interpolation interpolation: { Interpolation::Linear, Interpolation::Step, Interpolation::CubicSpline }) {
+        if (interpolation == Interpolation::Step) {
+            channel.step_begin = channel.tracks.size();
+        } else if (interpolation == Interpolation::CubicSpline) {
+            channel.cubic_begin = channel.tracks.size();
+        }
+
+        for (const AnimationCurve& curve: clip.curves) {
+            const K* frames = std::get_if<K>(&curve.keyframes.frames);
+            if (frames == nullptr || curve.interpolation != interpolation || curve.keyframe_timestamps.empty()) continue;
+
+            PackedTrack track {
+                .joint_index = curve.joint_index,
+                .timestamp_offset = curve.sample_rate > 0.0f ? 0 : pack_timeline(packed, timelines, curve.keyframe_timestamps),
+                .key_count = static_cast<uint32_t>(curve.keyframe_timestamps.size()),
+                .interpolation = curve.interpolation,
+                .sample_rate = curve.sample_rate
+            };
+
+            const std::vector<T>& values = frames->*keys;
+            if (interpolation == Interpolation::CubicSpline) {
+                track.value_offset = channel.coefficients.size() / 4;
+                pack_cubic_segments(channel.coefficients, curve.keyframe_timestamps, values, frames->in_tangents, frames->out_tangents);
+            } else {
+                track.value_offset = channel.values.size();
+                if constexpr (std::is_same_v<Key, QuantizedQuat>) {
+                    for (const glm::quat& value: values) {
+                        channel.values.push_back(quantize_rotation(value));
+                    }
+                } else {
+                    channel.values.insert(channel.values.end(), values.begin(), values.end());
+                }
+            }
+
+            pack_joint_tracks(packed, curve.joint_index).*joint_track = channel.tracks.size();
+            channel.tracks.push_back(track);
+        }
+    }
+}
+
+export PackedAnimationClip pack_animation_clip(const AnimationClip& clip) {
+    PackedAnimationClip packed { .duration = clip.duration };
+    std::vector<std::pair<uint32_t, uint32_t>> timelines;
+    pack_channel(packed, timelines, packed.rotations, clip, &Keyframes::Rotation::rotations, &JointTracks::rotation);
+    pack_channel(packed, timelines, packed.translations, clip, &Keyframes::Translation::translations, &JointTracks::translation);
+    pack_channel(packed, timelines, packed.scales, clip, &Keyframes::Scale::scales, &JointTracks::scale);
+
+    uint32_t pose_offset = 0;
+    for (const AnimationCurve& curve: clip.curves) {
+        const Keyframes::Weights* frames = std::get_if<Keyframes::Weights>(&curve.keyframes.frames);
+        if (frames == nullptr || curve.keyframe_timestamps.empty() || frames->count == 0) continue;
+
+        pack_joint_tracks(packed, curve.joint_index).weights = packed.weight_tracks.size();
+        packed.weight_tracks.push_back(PackedWeightTrack {
+            .track = PackedTrack {
+                .joint_index = curve.joint_index,
+                .timestamp_offset = curve.sample_rate > 0.0f ? 0 : pack_timeline(packed, timelines, curve.keyframe_timestamps),
+                .value_offset = 0,
+                .key_count = static_cast<uint32_t>(curve.keyframe_timestamps.size()),
+                .interpolation = curve.interpolation == Interpolation::Step ? Interpolation::Step : Interpolation::Linear,
+                .sample_rate = curve.sample_rate
+            },
+            .weight_offset = static_cast<uint32_t>(packed.weights.size()),
+            .weight_count = frames->count,
+            .pose_offset = pose_offset
+        });
+        packed.weights.insert(packed.weights.end(), frames->weights.begin(), frames->weights.end());
+        pose_offset += frames->count;
+    }
+    return packed;
+}
+
+// Returns the index of the last key with a timestamp at or before seek_time.
+// Expects timestamps[0] <= seek_time < timestamps[count - 1].
+uint32_t search_keyframe(const float* timestamps, const uint32_t count, const float seek_time) {
+    if (count <= SMALL_TRACK_KEYS) {
+        uint32_t keys_before = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            keys_before += timestamps[i] <= seek_time;
+        }
+        return keys_before - 1;
+    }
+    return std::distance(timestamps, std::upper_bound(timestamps, timestamps + count, seek_time)) - 1;
+}
+
+KeySample find_uniform_key_sample(const PackedTrack& track, const float seek_time, uint32_t& cursor) {
+    const float position = seek_time * track.sample_rate;
+    if (track.key_count == 1 || position <= 0.0f) {
+        cursor = 0;
+        return KeySample { track.value_offset, track.value_offset, 0.0f };
+    }
+    const uint32_t previous = static_cast<uint32_t>(position);
+    if (previous >= track.key_count - 1) {
+        cursor = track.key_count - 1;
+        return KeySample { cursor + track.value_offset, cursor + track.value_offset, 0.0f };
+    }
+    cursor = previous;
+    return KeySample { track.value_offset + previous, track.value_offset + previous + 1, position - previous };
+}
+
+KeySample find_key_sample(const PackedTrack& track, const std::vector<float>& timestamps, const float seek_time, uint32_t& cursor, const bool monotonic) {
+    if (track.sample_rate > 0.0f) {
+        return find_uniform_key_sample(track, seek_time, cursor);
+    }
+
+    const float* begin = timestamps.data() + track.timestamp_offset;
+    if (track.key_count == 1 || seek_time <= begin[0]) {
+        cursor = 0;
+        return KeySample { track.value_offset, track.value_offset, 0.0f };
+    }
+    if (seek_time >= begin[track.key_count - 1]) {
+        cursor = track.key_count - 1;
+        return KeySample { cursor + track.value_offset, cursor + track.value_offset, 0.0f };
+    }
+
+    uint32_t previous = cursor;
+    if (monotonic && previous < track.key_count && begin[previous] <= seek_time) {
+        uint32_t steps = 0;
+        while (begin[previous + 1] <= seek_time) {
+            previous++;
+            if (++steps == MAX_CURSOR_STEPS) {
+                previous = search_keyframe(begin, track.key_count, seek_time);
+                break;
+            }
+        }
+    } else {
+        previous = search_keyframe(begin, track.key_count, seek_time);
+    }
+    cursor = previous;
+
+    const float previous_time = begin[previous];
+    const float next_time = begin[previous + 1];
+    const float t = (seek_time - previous_time) / (next_time - previous_time);
+    return KeySample { track.value_offset + previous, track.value_offset + previous + 1, t };
+}
+
+export glm::quat nlerp(const glm::quat& a, glm::quat b, const float t) {
+    if (glm::dot(a, b) < 0.0f) {
+        b = -b;
+    }
+    return glm::normalize(a + (b - a) * t);
+}
+
+glm::quat decode_key(const QuantizedQuat key) {
+    return dequantize_rotation(key);
+}
+
+glm::vec3 decode_key(const glm::vec3& key) {
+    return key;
+}
+
+void sample_rotations(const std::vector<QuantizedQuat>& values, std::span<const KeySample> samples, glm::quat* output) {
+    size_t i = 0;
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= samples.size(); i += 4) {
+        const KeySample* s = &samples[i];
+        glm::quat previous[4];
+        glm::quat next[4];
+        for (uint32_t j = 0; j < 4; j++) {
+            previous[j] = dequantize_rotation(values[s[j].previous]);
+            next[j] = dequantize_rotation(values[s[j].next]);
+        }
+        // glm::quat is laid out as x, y, z, w, so each load is one key and the transpose gives one
+        // register per component across four tracks.
+        __m128 ax = _mm_loadu_ps(&previous[0].x);
+        __m128 ay = _mm_loadu_ps(&previous[1].x);
+        __m128 az = _mm_loadu_ps(&previous[2].x);
+        __m128 aw = _mm_loadu_ps(&previous[3].x);
+        _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+        __m128 bx = _mm_loadu_ps(&next[0].x);
+        __m128 by = _mm_loadu_ps(&next[1].x);
+        __m128 bz = _mm_loadu_ps(&next[2].x);
+        __m128 bw = _mm_loadu_ps(&next[3].x);
+        _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+        const __m128 t = _mm_set_ps(s[3].t, s[2].t, s[1].t, s[0].t);
+
+        // Take the shortest arc by flipping the sign of b wherever a.b is negative.
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+        const __m128 flip = _mm_and_ps(dot, sign_mask);
+        bx = _mm_xor_ps(bx, flip);
+        by = _mm_xor_ps(by, flip);
+        bz = _mm_xor_ps(bz, flip);
+        bw = _mm_xor_ps(bw, flip);
+
+        __m128 rx = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), t));
+        __m128 ry = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), t));
+        __m128 rz = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), t));
+        __m128 rw = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), t));
+
+        const __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw)));
+        const __m128 inverse_length = _mm_div_ps(one, _mm_sqrt_ps(length_squared));
+        rx = _mm_mul_ps(rx, inverse_length);
+        ry = _mm_mul_ps(ry, inverse_length);
+        rz = _mm_mul_ps(rz, inverse_length);
+        rw = _mm_mul_ps(rw, inverse_length);
+
+        _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+        _mm_storeu_ps(&output[i].x, rx);
+        _mm_storeu_ps(&output[i + 1].x, ry);
+        _mm_storeu_ps(&output[i + 2].x, rz);
+        _mm_storeu_ps(&output[i + 3].x, rw);
+    }
+    for (; i < samples.size(); i++) {
+        output[i] = nlerp(dequantize_rotation(values[samples[i].previous]), dequantize_rotation(values[samples[i].next]), samples[i].t);
+    }
+}
+
+void sample_vectors(const std::vector<glm::vec3>& values, std::span<const KeySample> samples, glm::vec3* output) {
+    size_t i = 0;
+    for (; i + 4 <= samples.size(); i += 4) {
+        const KeySample* s = &samples[i];
+        const glm::vec3& a0 = values[s[0].previous];
+        const glm::vec3& a1 = values[s[1].previous];
+        const glm::vec3& a2 = values[s[2].previous];
+        const glm::vec3& a3 = values[s[3].previous];
+        const glm::vec3& b0 = values[s[0].next];
+        const glm::vec3& b1 = values[s[1].next];
+        const glm::vec3& b2 = values[s[2].next];
+        const glm::vec3& b3 = values[s[3].next];
+        const __m128 t = _mm_set_ps(s[3].t, s[2].t, s[1].t, s[0].t);
+
+        const __m128 ax = _mm_set_ps(a3.x, a2.x, a1.x, a0.x);
+        const __m128 ay = _mm_set_ps(a3.y, a2.y, a1.y, a0.y);
+        const __m128 az = _mm_set_ps(a3.z, a2.z, a1.z, a0.z);
+        const __m128 bx = _mm_set_ps(b3.x, b2.x, b1.x, b0.x);
+        const __m128 by = _mm_set_ps(b3.y, b2.y, b1.y, b0.y);
+        const __m128 bz = _mm_set_ps(b3.z, b2.z, b1.z, b0.z);
+
+        alignas(16) float rx[4];
+        alignas(16) float ry[4];
+        alignas(16) float rz[4];
+        _mm_store_ps(rx, _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), t)));
+        _mm_store_ps(ry, _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), t)));
+        _mm_store_ps(rz, _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), t)));
+        for (uint32_t j = 0; j < 4; j++) {
+            output[i + j] = glm::vec3(rx[j], ry[j], rz[j]);
+        }
+    }
+    for (; i < samples.size(); i++) {
+        output[i] = glm::lerp(values[samples[i].previous], values[samples[i].next], samples[i].t);
+    }
+}
+
+template<typename T, typename Key>
+void sample_step(const std::vector<Key>& values, std::span<const KeySample> samples, T* output) {
+    for (size_t i = 0; i < samples.size(); i++) {
+        output[i] = decode_key(values[samples[i].previous]);
+    }
+}
+
+template<typename T>
+void sample_cubic(const std::vector<T>& coefficients, std::span<const KeySample> samples, T* output) {
+    for (size_t i = 0; i < samples.size(); i++) {
+        const T* c = &coefficients[4 * samples[i].previous];
+        const float s = samples[i].t;
+        const T value = ((c[3] * s + c[2]) * s + c[1]) * s + c[0];
+        if constexpr (std::is_same_v<T, glm::quat>) {
+            output[i] = glm::normalize(value);
+        } else {
+            output[i] = value;
+        }
+    }
+}
+
+template<typename T, typename Key>
+void sample_channel(
+    const PackedChannel<T, Key>& channel,
+    const std::vector<float>& timestamps,
+    const float seek_time,
+    const bool monotonic,
+    std::vector<uint32_t>& cursors,
+    std::vector<KeySample>& samples,
+    std::vector<T>& output
+) {
+    const std::vector<PackedTrack>& tracks = channel.tracks;
+    cursors.resize(tracks.size());
+    samples.resize(tracks.size());
+    output.resize(tracks.size());
+    for (uint32_t i = 0; i < tracks.size(); i++) {
+        samples[i] = find_key_sample(tracks[i], timestamps, seek_time, cursors[i], monotonic);
+    }
+
+    const std::span<const KeySample> all_samples(samples);
+    const std::span<const KeySample> linear = all_samples.subspan(0, channel.step_begin);
+    const std::span<const KeySample> step = all_samples.subspan(channel.step_begin, channel.cubic_begin - channel.step_begin);
+    const std::span<const KeySample> cubic = all_samples.subspan(channel.cubic_begin);
+    if constexpr (std::is_same_v<T, glm::quat>) {
+        sample_rotations(channel.values, linear, output.data());
+    } else {
+        sample_vectors(channel.values, linear, output.data());
+    }
+    sample_step(channel.values, step, output.data() + channel.step_begin);
+    sample_cubic(channel.coefficients, cubic, output.data() + channel.cubic_begin);
+}
+
+void sample_weights(const PackedAnimationClip& clip, const float seek_time, const bool monotonic, std::vector<uint32_t>& cursors, std::vector<float>& output) {
+    cursors.resize(clip.weight_tracks.size());
+    output.resize(clip.weight_tracks.empty() ? 0 : clip.weight_tracks.back().pose_offset + clip.weight_tracks.back().weight_count);
+    for (uint32_t i = 0; i < clip.weight_tracks.size(); i++) {
+        const PackedWeightTrack& track = clip.weight_tracks[i];
+        const KeySample sample = find_key_sample(track.track, clip.timestamps, seek_time, cursors[i], monotonic);
+        const float* previous = clip.weights.data() + track.weight_offset + sample.previous * track.weight_count;
+        const float* next = clip.weights.data() + track.weight_offset + sample.next * track.weight_count;
+        float* weights = output.data() + track.pose_offset;
+        if (track.track.interpolation == Interpolation::Step) {
+            std::copy_n(previous, track.weight_count, weights);
+            continue;
+        }
+        for (uint32_t w = 0; w < track.weight_count; w++) {
+            weights[w] = previous[w] + (next[w] - previous[w]) * sample.t;
+        }
+    }
+}
+
+export void sample_clip(const PackedAnimationClip& clip, const float seek_time, KeyframeCursors& cursors, AnimationPose& pose) {
+    // Cursors are only trusted while time moves forward; a loop or a seek falls back to a search.
+    const bool monotonic = cursors.valid && seek_time >= cursors.seek_time;
+    sample_channel(clip.rotations, clip.timestamps, seek_time, monotonic, cursors.rotations, pose.samples, pose.rotations);
+    sample_channel(clip.translations, clip.timestamps, seek_time, monotonic, cursors.translations, pose.samples, pose.translations);
+    sample_channel(clip.scales, clip.timestamps, seek_time, monotonic, cursors.scales, pose.samples, pose.scales);
+    sample_weights(clip, seek_time, monotonic, cursors.weights, pose.weights);
+    cursors.seek_time = seek_time;
+    cursors.valid = true;
+}
+
 export struct ActiveAnimation {
     float speed;
     bool playing;
     float seek_time;
 };
 
+// A target node of the player's hierarchy and the clip tracks that drive it.
+export struct AnimationBinding {
+    flecs::entity target;
+    JointTracks tracks;
+    bool leaf;
+    Transform rest;
+};
+
+// Lives on the root entity of a character and drives the AnimationTargets below it.
 export struct AnimationPlayer {
     flecs::entity animation;
     ActiveAnimation active_animation;
+    AnimationPose pose{};
+    KeyframeCursors cursors{};
+    std::vector<AnimationBinding> bindings{};
+    flecs::entity bound_animation{};
+    // Bumped whenever bindings are rebuilt, so state resolved against them knows to resolve again.
+    uint32_t bindings_version = 0;
 
     void play() {
         active_animation.playing = true;
@@ -73,74 +751,438 @@ export struct AnimationPlayer {
     void pause() {
         active_animation.playing = false;
     }
+
+    void seek(const float seek_time) {
+        active_animation.seek_time = seek_time;
+        cursors.valid = false;
+    }
+};
+
+// Players with this tag are posed by the render plugin's animation compute pass; apply_animations
+// leaves their hierarchy alone and only the seek time advances on the CPU.
+export struct GPUAnimation {};
+
+// Players with this tag are not sampled per character. Their skinned meshes draw palettes from the
+// render plugin's pose cache, shared by every character showing the same clip at the same frame.
+export struct CachedPose {};
+
+// A clip of a blend layer. Clip weights are normalized within their layer.
+export struct BlendClip {
+    flecs::entity animation;
+    float weight = 0.0f;
+    float seek_time = 0.0f;
+    float speed = 1.0f;
+
+    flecs::entity bound_animation{};
+    uint32_t bound_bindings_version = 0;
+    std::vector<JointTracks> tracks{};
+    KeyframeCursors cursors{};
 };
 
+// Layers apply in order on top of the rest pose, each blending its clips' weighted pose over the
+// result so far by weight, clamped to 1. A non-empty mask limits the layer to those joint indices,
+// e.g. the upper body. Synchronized layers advance all clips by one normalized phase, so locomotion
+// cycles of different lengths stay in step.
+export struct BlendLayer {
+    std::vector<BlendClip> clips;
+    float weight = 1.0f;
+    std::vector<uint32_t> mask{};
+    bool synchronize = false;
+    float phase = 0.0f;
+
+    // Per binding, whether mask includes its joint; rebuilt when mask or the player's bindings change.
+    std::vector<bool> in_mask{};
+    std::vector<uint32_t> bound_mask{};
+    uint32_t bound_bindings_version = 0;
+};
+
+// Replaces the AnimationPlayer's single clip when present. The player still provides the bindings,
+// playback state and speed.
+export struct AnimationBlendTree {
+    std::vector<BlendLayer> layers;
+};
+
+// A node driven by animation, by its joint index in the skeleton the clips were imported against.
+// rest is the node's default local transform, which blend trees fall back to where no clip
+// animates it.
 export struct AnimationTarget {
-    uint32_t node_index;
+    uint32_t joint_index;
+    Transform rest;
 };
 
-void advance_animations(flecs::iter& it) {
-    while (it.next()) {
-        auto player = it.field<AnimationPlayer>(0);
-        const AnimationClip* clip = player[0].animation.get<AnimationClip>();
-        auto delta = it.delta_time();
-        if (player->active_animation.playing) {
-            if (player->active_animation.seek_time + (player->active_animation.speed * delta) > clip->duration) {
-                player->active_animation.seek_time = 0;
+// Characters further than distances[i] times their radius from the viewer drop to LOD i + 1, which
+// updates their pose every 2^(i + 1) frames. From skip_leaf_joints_level on, joints without animated
+// children (fingers, face) keep their last pose. From vertex_animation_level on, characters with a
+// baked vertex animation for their clip play it back instead of being posed.
+export struct AnimationLodSettings {
+    flecs::entity viewer;
+    std::array<float, 3> distances { 10.0f, 25.0f, 50.0f };
+    uint32_t skip_leaf_joints_level = 2;
+    uint32_t vertex_animation_level = 3;
+};
+
+export struct AnimationLod {
+    float radius = 1.0f;
+    uint32_t level = 0;
+    bool update = true;
+    bool skip_leaf_joints = false;
+    bool vertex_animation = false;
+};
+
+// Added by the renderer to players, and their skinned meshes, that currently draw from a baked vertex
+// animation. Such players are not posed.
+export struct VertexAnimationActive {};
+
+void collect_animation_targets(const flecs::entity entity, std::vector<AnimationBinding>& bindings) {
+    const size_t index = bindings.size();
+    if (const AnimationTarget* target = entity.get<AnimationTarget>()) {
+        bindings.push_back(AnimationBinding {
+            .target = entity,
+            .tracks = JointTracks { .joint_index = target->joint_index },
+            .rest = target->rest
+        });
+    }
+    entity.children([&](const flecs::entity child) {
+        collect_animation_targets(child, bindings);
+    });
+    if (index < bindings.size()) {
+        bindings[index].leaf = bindings.size() == index + 1;
+    }
+}
+
+// Collects every AnimationTarget in the hierarchy under the player's entity. Call again after
+// nodes are added to or removed from the hierarchy.
+export void bind_animation_targets(const flecs::entity entity) {
+    AnimationPlayer* player = entity.get_mut<AnimationPlayer>();
+    player->bindings.clear();
+    player->bound_animation = flecs::entity::null();
+    player->bindings_version++;
+    collect_animation_targets(entity, player->bindings);
+}
+
+void resolve_bindings(AnimationPlayer& player, const PackedAnimationClip& clip) {
+    for (AnimationBinding& binding: player.bindings) {
+        const uint32_t joint_index = binding.tracks.joint_index;
+        const JointTracks* tracks = clip.find_joint_tracks(joint_index);
+        binding.tracks = tracks != nullptr ? *tracks : JointTracks { .joint_index = joint_index };
+    }
+    player.bound_animation = player.animation;
+    player.cursors.valid = false;
+}
+
+void advance_animations(flecs::iter& it, size_t, AnimationPlayer& player) {
+    if (!player.active_animation.playing) return;
+
+    const PackedAnimationClip* clip = player.animation.get<PackedAnimationClip>();
+    if (clip == nullptr) return;
+    const float delta = player.active_animation.speed * it.delta_time();
+    if (player.active_animation.seek_time + delta > clip->duration) {
+        player.active_animation.seek_time = 0;
+    } else {
+        player.active_animation.seek_time += delta;
+    }
+}
+
+// Picks each character's LOD from its distance to the viewer and decides whether this is one of its
+// update frames. The entity id staggers characters on the same LOD across frames so the number of
+// poses evaluated per frame stays flat.
+void update_animation_lods(flecs::iter& it, size_t i, const AnimationLodSettings& settings, AnimationLod& lod, const GlobalTransform& transform) {
+    lod.level = 0;
+    if (const GlobalTransform* viewer = settings.viewer.is_valid() ? settings.viewer.get<GlobalTransform>() : nullptr) {
+        const float distance = glm::distance(glm::vec3(viewer->transform[3]), glm::vec3(transform.transform[3])) / lod.radius;
+        while (lod.level < settings.distances.size() && distance > settings.distances[lod.level]) {
+            lod.level++;
+        }
+    }
+
+    const uint64_t frame = it.world().get_info()->frame_count_total + it.entity(i).id();
+    lod.update = frame % (1ull << lod.level) == 0;
+    lod.skip_leaf_joints = lod.level >= settings.skip_leaf_joints_level;
+    lod.vertex_animation = lod.level >= settings.vertex_animation_level;
+}
+
+// Runs on the worker threads: each player only samples its own clip and writes the Transforms of
+// its own hierarchy, so players can be split across threads without synchronization.
+void apply_animations(AnimationPlayer& player, const AnimationLod* lod) {
+    if (!player.active_animation.playing) return;
+    if (lod != nullptr && !lod->update) return;
+    const bool skip_leaf_joints = lod != nullptr && lod->skip_leaf_joints;
+
+    const PackedAnimationClip* clip = player.animation.get<PackedAnimationClip>();
+    if (clip == nullptr) return;
+    if (player.bound_animation != player.animation) {
+        resolve_bindings(player, *clip);
+    }
+    sample_clip(*clip, player.active_animation.seek_time, player.cursors, player.pose);
+
+    for (const AnimationBinding& binding: player.bindings) {
+        if (skip_leaf_joints && binding.leaf) continue;
+        // Split targets only have the columns their tracks animate written.
+        if (binding.target.has<Translation>()) {
+            if (binding.tracks.rotation != NO_TRACK) {
+                binding.target.get_mut<Rotation>()->value = player.pose.rotations[binding.tracks.rotation];
+            }
+            if (binding.tracks.translation != NO_TRACK) {
+                binding.target.get_mut<Translation>()->value = player.pose.translations[binding.tracks.translation];
+            }
+            if (binding.tracks.scale != NO_TRACK) {
+                binding.target.get_mut<Scale>()->value = player.pose.scales[binding.tracks.scale];
+            }
+        } else {
+            Transform* transform = binding.target.get_mut<Transform>();
+            if (binding.tracks.rotation != NO_TRACK) {
+                transform->rotation = player.pose.rotations[binding.tracks.rotation];
+            }
+            if (binding.tracks.translation != NO_TRACK) {
+                transform->translation = player.pose.translations[binding.tracks.translation];
+            }
+            if (binding.tracks.scale != NO_TRACK) {
+                transform->scale = player.pose.scales[binding.tracks.scale];
+            }
+        }
+        if (binding.tracks.weights != NO_TRACK) {
+            if (MorphWeights* weights = binding.target.get_mut<MorphWeights>()) {
+                const PackedWeightTrack& track = clip->weight_tracks[binding.tracks.weights];
+                const size_t count = std::min<size_t>(track.weight_count, weights->weights.size());
+                std::copy_n(player.pose.weights.begin() + track.pose_offset, count, weights->weights.begin());
+            }
+        }
+    }
+}
+
+// Layers or clips below this weight are skipped entirely.
+constexpr float MIN_BLEND_WEIGHT = 0.001f;
+
+// Clips whose entity has no PackedAnimationClip are skipped, as if their weight were zero.
+const PackedAnimationClip* blend_clip_data(const BlendClip& clip) {
+    return clip.animation.is_valid() ? clip.animation.get<PackedAnimationClip>() : nullptr;
+}
+
+void advance_blend_tree(flecs::iter& it, size_t, const AnimationPlayer& player, AnimationBlendTree& tree) {
+    if (!player.active_animation.playing) return;
+
+    const float delta = player.active_animation.speed * it.delta_time();
+    for (BlendLayer& layer: tree.layers) {
+        if (layer.synchronize) {
+            float total_weight = 0.0f;
+            float phase_rate = 0.0f;
+            for (const BlendClip& clip: layer.clips) {
+                const PackedAnimationClip* packed = blend_clip_data(clip);
+                if (packed == nullptr || clip.weight < MIN_BLEND_WEIGHT || packed->duration <= 0.0f) continue;
+                total_weight += clip.weight;
+                phase_rate += clip.weight * clip.speed / packed->duration;
+            }
+            if (total_weight > 0.0f) {
+                layer.phase = std::fmod(layer.phase + delta * phase_rate / total_weight, 1.0f);
+            }
+            for (BlendClip& clip: layer.clips) {
+                if (const PackedAnimationClip* packed = blend_clip_data(clip)) {
+                    clip.seek_time = layer.phase * packed->duration;
+                }
+            }
+            continue;
+        }
+
+        for (BlendClip& clip: layer.clips) {
+            const PackedAnimationClip* packed = blend_clip_data(clip);
+            if (packed == nullptr) continue;
+            const float duration = packed->duration;
+            const float clip_delta = clip.speed * delta;
+            if (clip.seek_time + clip_delta > duration) {
+                clip.seek_time = 0;
             } else {
-                player->active_animation.seek_time += (player->active_animation.speed * delta);
+                clip.seek_time += clip_delta;
             }
         }
     }
 }
 
-void apply_animations(AnimationPlayer& player, Transform& transform, AnimationTarget& target) {
+template<typename T, typename Key>
+T sample_track(const PackedChannel<T, Key>& channel, const std::vector<float>& timestamps, const uint32_t track_index, const float seek_time, std::vector<uint32_t>& cursors, const bool monotonic) {
+    const PackedTrack& track = channel.tracks[track_index];
+    const KeySample sample = find_key_sample(track, timestamps, seek_time, cursors[track_index], monotonic);
+    if (track.interpolation == Interpolation::CubicSpline) {
+        T value;
+        sample_cubic(channel.coefficients, std::span(&sample, 1), &value);
+        return value;
+    }
+    if (track.interpolation == Interpolation::Step) {
+        return decode_key(channel.values[sample.previous]);
+    }
+    if constexpr (std::is_same_v<T, glm::quat>) {
+        return nlerp(decode_key(channel.values[sample.previous]), decode_key(channel.values[sample.next]), sample.t);
+    } else {
+        return glm::lerp(decode_key(channel.values[sample.previous]), decode_key(channel.values[sample.next]), sample.t);
+    }
+}
+
+struct ActiveBlendClip {
+    const PackedAnimationClip* clip;
+    BlendClip* state;
+    float weight;
+    bool monotonic;
+};
+
+void resolve_blend_clip(BlendClip& clip, const AnimationPlayer& player, const PackedAnimationClip& packed) {
+    const std::vector<AnimationBinding>& bindings = player.bindings;
+    clip.tracks.resize(bindings.size());
+    for (uint32_t b = 0; b < bindings.size(); b++) {
+        const uint32_t joint_index = bindings[b].tracks.joint_index;
+        const JointTracks* tracks = packed.find_joint_tracks(joint_index);
+        clip.tracks[b] = tracks != nullptr ? *tracks : JointTracks { .joint_index = joint_index };
+    }
+    clip.cursors = KeyframeCursors {};
+    clip.cursors.rotations.resize(packed.rotations.tracks.size());
+    clip.cursors.translations.resize(packed.translations.tracks.size());
+    clip.cursors.scales.resize(packed.scales.tracks.size());
+    clip.bound_animation = clip.animation;
+    clip.bound_bindings_version = player.bindings_version;
+}
+
+// Evaluates the whole tree in one pass over the skeleton: for every binding the weighted pose of
+// each layer is accumulated from its active clips and blended into the result in locals, and the
+// Transform is written once. Only clips with a weight above MIN_BLEND_WEIGHT are sampled.
+void apply_blend_tree(AnimationPlayer& player, AnimationBlendTree& tree, const AnimationLod* lod) {
     if (!player.active_animation.playing) return;
+    if (lod != nullptr && !lod->update) return;
+    const bool skip_leaf_joints = lod != nullptr && lod->skip_leaf_joints;
+
+    std::vector<ActiveBlendClip> active;
+    std::vector<std::pair<const BlendLayer*, std::pair<uint32_t, uint32_t>>> layers;
+    for (BlendLayer& layer: tree.layers) {
+        if (layer.weight < MIN_BLEND_WEIGHT) continue;
+        float total_weight = 0.0f;
+        for (const BlendClip& clip: layer.clips) {
+            if (clip.weight >= MIN_BLEND_WEIGHT && blend_clip_data(clip) != nullptr) {
+                total_weight += clip.weight;
+            }
+        }
+        if (total_weight < MIN_BLEND_WEIGHT) continue;
+
+        if (layer.bound_bindings_version != player.bindings_version || layer.in_mask.size() != player.bindings.size() || layer.bound_mask != layer.mask) {
+            layer.in_mask.resize(player.bindings.size());
+            for (uint32_t b = 0; b < player.bindings.size(); b++) {
+                layer.in_mask[b] = layer.mask.empty() || std::ranges::find(layer.mask, player.bindings[b].tracks.joint_index) != layer.mask.end();
+            }
+            layer.bound_mask = layer.mask;
+            layer.bound_bindings_version = player.bindings_version;
+        }
+
+        const uint32_t begin = active.size();
+        for (BlendClip& clip: layer.clips) {
+            const PackedAnimationClip* packed = blend_clip_data(clip);
+            if (clip.weight < MIN_BLEND_WEIGHT || packed == nullptr) continue;
+            if (clip.bound_animation != clip.animation || clip.bound_bindings_version != player.bindings_version || clip.tracks.size() != player.bindings.size()) {
+                resolve_blend_clip(clip, player, *packed);
+            }
+            active.push_back(ActiveBlendClip {
+                .clip = packed,
+                .state = &clip,
+                .weight = clip.weight / total_weight,
+                .monotonic = clip.cursors.valid && clip.seek_time >= clip.cursors.seek_time
+            });
+        }
+        layers.emplace_back(&layer, std::make_pair(begin, static_cast<uint32_t>(active.size())));
+    }
+
+    for (uint32_t b = 0; b < player.bindings.size(); b++) {
+        const AnimationBinding& binding = player.bindings[b];
+        if (skip_leaf_joints && binding.leaf) continue;
+
+        const Transform& rest = binding.rest;
+        Transform pose = rest;
+        for (const auto& [layer, range]: layers) {
+            if (!layer->in_mask[b]) continue;
 
-    const AnimationClip* clip = player.animation.get<AnimationClip>();
-    for (const AnimationCurve& curve: clip->curves[target.node_index]) {
-        const auto keyframe_index = curve.find_keyframe(player.active_animation.seek_time).value();
-        const auto previous_time = curve.keyframe_timestamps[keyframe_index];
-        const auto next_time = curve.keyframe_timestamps[keyframe_index + 1];
-        const auto interpolation_value = std::max((player.active_animation.seek_time - previous_time) / (next_time - previous_time), 0.0f);
-        std::visit(
-            [&](auto&& arg) {
-                const auto node = target.node_index;
-                using T = std::decay_t<decltype(arg)>;
-                if constexpr (std::is_same_v<T, Keyframes::Rotation>) {
-                    const auto previous_rotation = arg.rotations[keyframe_index];
-                    const auto next_rotation = arg.rotations[keyframe_index + 1];
-                    const auto new_rotation = glm::slerp(previous_rotation, next_rotation, interpolation_value);
-                    transform.rotation = new_rotation;
-                } else if constexpr (std::is_same_v<T, Keyframes::Translation>) {
-                    const glm::vec3& previous_translation = arg.translations[keyframe_index];
-                    const glm::vec3& next_translation = arg.translations[keyframe_index + 1];
-                    const glm::vec3 new_translation = glm::lerp(previous_translation, next_translation, interpolation_value);
-                    transform.translation = new_translation;
-                } else if constexpr (std::is_same_v<T, Keyframes::Scale>) {
-                    const auto previous_scale = arg.scales[keyframe_index];
-                    const auto next_scale = arg.scales[keyframe_index + 1];
-                    const auto new_scale = glm::lerp(previous_scale, next_scale, interpolation_value);
-                    transform.scale = new_scale;
+            glm::vec3 translation(0.0f);
+            glm::quat rotation(0.0f, 0.0f, 0.0f, 0.0f);
+            glm::vec3 scale(0.0f);
+            for (uint32_t c = range.first; c < range.second; c++) {
+                const ActiveBlendClip& clip = active[c];
+                const JointTracks& tracks = clip.state->tracks[b];
+                KeyframeCursors& cursors = clip.state->cursors;
+                const float seek_time = clip.state->seek_time;
+
+                const glm::vec3 clip_translation = tracks.translation != NO_TRACK
+                    ? sample_track(clip.clip->translations, clip.clip->timestamps, tracks.translation, seek_time, cursors.translations, clip.monotonic)
+                    : rest.translation;
+                glm::quat clip_rotation = tracks.rotation != NO_TRACK
+                    ? sample_track(clip.clip->rotations, clip.clip->timestamps, tracks.rotation, seek_time, cursors.rotations, clip.monotonic)
+                    : rest.rotation;
+                const glm::vec3 clip_scale = tracks.scale != NO_TRACK
+                    ? sample_track(clip.clip->scales, clip.clip->timestamps, tracks.scale, seek_time, cursors.scales, clip.monotonic)
+                    : rest.scale;
+
+                // Keep every rotation in the hemisphere of the running sum so they do not cancel out.
+                if (glm::dot(rotation, clip_rotation) < 0.0f) {
+                    clip_rotation = -clip_rotation;
                 }
-            },
-            curve.keyframes.frames
-        );
+                translation += clip_translation * clip.weight;
+                rotation = rotation + clip_rotation * clip.weight;
+                scale += clip_scale * clip.weight;
+            }
+
+            const float layer_weight = std::min(layer->weight, 1.0f);
+            pose.translation = glm::lerp(pose.translation, translation, layer_weight);
+            pose.rotation = nlerp(pose.rotation, glm::normalize(rotation), layer_weight);
+            pose.scale = glm::lerp(pose.scale, scale, layer_weight);
+        }
+        set_local_transform(binding.target, pose);
+    }
+
+    for (const ActiveBlendClip& clip: active) {
+        clip.state->cursors.seek_time = clip.state->seek_time;
+        clip.state->cursors.valid = true;
     }
 }
 
 export void initialize_animation_plugin(const flecs::world& world) {
+    // Pose caching and animation LODs read these world transforms on the CPU.
+    world.component<AnimationPlayer>().add(flecs::With, world.component<CpuTransform>());
+    world.component<AnimationLod>().add(flecs::With, world.component<CpuTransform>());
+
+    // Blend trees advance their own clips, see "Advance Blend Trees".
     auto advance_animations_system = world.system<AnimationPlayer>("Advance Animations")
-        .term_at(0).singleton().inout(flecs::InOut)
-        .write<AnimationPlayer>()
+        .without<AnimationBlendTree>()
+        .kind(flecs::OnUpdate)
+        .each(advance_animations);
+
+    world.set<AnimationLodSettings>({});
+    auto update_animation_lods_system = world.system<const AnimationLodSettings, AnimationLod, const GlobalTransform>("Update Animation LODs")
+        .term_at(0).singleton()
         .kind(flecs::OnUpdate)
-        .run(advance_animations);
+        .each(update_animation_lods);
 
-    auto apply_animations_system = world.system<AnimationPlayer, Transform, AnimationTarget>("Apply Animations")
-        .term_at(0).singleton().inout(flecs::InOut)
+    auto apply_animations_system = world.system<AnimationPlayer, const AnimationLod*>("Apply Animations")
+        .without<GPUAnimation>()
+        .without<CachedPose>()
+        .without<VertexAnimationActive>()
+        .without<AnimationBlendTree>()
         .write<Transform>()
+        .write<Translation>()
+        .write<Rotation>()
+        .write<Scale>()
         .kind(flecs::OnUpdate)
+        .multi_threaded()
         .each(apply_animations);
 
-    apply_animations_system.depends_on(advance_animations_system);
+    auto advance_blend_trees_system = world.system<const AnimationPlayer, AnimationBlendTree>("Advance Blend Trees")
+        .kind(flecs::OnUpdate)
+        .each(advance_blend_tree);
+
+    auto apply_blend_trees_system = world.system<AnimationPlayer, AnimationBlendTree, const AnimationLod*>("Apply Blend Trees")
+        .without<VertexAnimationActive>()
+        .write<Transform>()
+        .write<Translation>()
+        .write<Rotation>()
+        .write<Scale>()
+        .kind(flecs::OnUpdate)
+        .multi_threaded()
+        .each(apply_blend_tree);
+
+    update_animation_lods_system.depends_on(advance_animations_system);
+    apply_animations_system.depends_on(update_animation_lods_system);
+    advance_blend_trees_system.depends_on(advance_animations_system);
+    apply_blend_trees_system.depends_on(update_animation_lods_system);
+    apply_blend_trees_system.depends_on(advance_blend_trees_system);
 }
\ No newline at end of file
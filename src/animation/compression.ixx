@@ -0,0 +1,159 @@
+module;
+
+#include <vector>
+#include <variant>
+#include <cmath>
+#include <algorithm>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/compatibility.hpp>
+
+export module stellar.animation.compression;
+
+import stellar.animation;
+
+// Maximum error a removed keyframe may introduce. Translation and scale are in scene units,
+// rotation is the angle in radians between the original and the reconstructed key.
+export struct CompressionSettings {
+    float translation_tolerance = 0.0001f;
+    float rotation_tolerance = 0.0005f;
+    float scale_tolerance = 0.0001f;
+};
+
+export float key_error(const glm::vec3& a, const glm::vec3& b) {
+    return glm::length(a - b);
+}
+
+// Angle of the rotation from a to b, taken from the vector part of their difference: acos of the
+// dot product cannot resolve angles below about 7e-4 in float, asin keeps its precision near zero.
+export float key_error(const glm::quat& a, const glm::quat& b) {
+    const glm::quat difference = glm::conjugate(glm::normalize(a)) * glm::normalize(b);
+    const float half_sine = std::min(glm::length(glm::vec3(difference.x, difference.y, difference.z)), 1.0f);
+    return 2.0f * std::asin(half_sine);
+}
+
+export glm::vec3 interpolate_key(const glm::vec3& a, const glm::vec3& b, const float t) {
+    return glm::lerp(a, b, t);
+}
+
+export glm::quat interpolate_key(const glm::quat& a, const glm::quat& b, const float t) {
+    return nlerp(a, b, t);
+}
+
+template<typename T>
+void keep_keyframes(std::vector<float>& timestamps, std::vector<T>& values, const std::vector<uint32_t>& kept) {
+    for (uint32_t i = 0; i < kept.size(); i++) {
+        timestamps[i] = timestamps[kept[i]];
+        values[i] = values[kept[i]];
+    }
+    timestamps.resize(kept.size());
+    values.resize(kept.size());
+}
+
+template<typename T>
+bool reproduces_key(const AnimationCurve& curve, const std::vector<T>& values, const uint32_t anchor, const uint32_t candidate, const uint32_t k, const float tolerance) {
+    if (curve.interpolation == Interpolation::Step) {
+        return key_error(values[anchor], values[k]) <= tolerance;
+    }
+    const std::vector<float>& timestamps = curve.keyframe_timestamps;
+    const float t = (timestamps[k] - timestamps[anchor]) / (timestamps[candidate] - timestamps[anchor]);
+    return key_error(interpolate_key(values[anchor], values[candidate], t), values[k]) <= tolerance;
+}
+
+template<typename T>
+bool is_constant(const std::vector<T>& values, const float tolerance) {
+    return std::ranges::all_of(values, [&](const T& value) { return key_error(values[0], value) <= tolerance; });
+}
+
+// Removing keys from a uniformly resampled curve would lose its constant-time lookup.
+bool is_reducible(const AnimationCurve& curve) {
+    return curve.sample_rate <= 0.0f && curve.interpolation != Interpolation::CubicSpline && (
+        std::holds_alternative<Keyframes::Rotation>(curve.keyframes.frames) ||
+        std::holds_alternative<Keyframes::Translation>(curve.keyframes.frames) ||
+        std::holds_alternative<Keyframes::Scale>(curve.keyframes.frames)
+    );
+}
+
+template<typename F>
+void visit_keys(AnimationCurve& curve, const CompressionSettings& settings, F&& f) {
+    std::visit(
+        [&](auto&& arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, Keyframes::Rotation>) {
+                f(arg.rotations, settings.rotation_tolerance);
+            } else if constexpr (std::is_same_v<T, Keyframes::Translation>) {
+                f(arg.translations, settings.translation_tolerance);
+            } else if constexpr (std::is_same_v<T, Keyframes::Scale>) {
+                f(arg.scales, settings.scale_tolerance);
+            }
+        },
+        curve.keyframes.frames
+    );
+}
+
+// Greedily extends each segment for as long as every key it skips is reproduced within tolerance
+// by every curve on the timeline, the same way the sampler will: linear curves interpolate the
+// segment end points, step curves hold the first. Returns the indices of the keys to keep.
+std::vector<uint32_t> reduce_timeline(const std::vector<AnimationCurve*>& curves, const CompressionSettings& settings) {
+    const uint32_t key_count = curves[0]->keyframe_timestamps.size();
+    const auto reproduced = [&](const uint32_t anchor, const uint32_t candidate, const uint32_t k) {
+        return std::ranges::all_of(curves, [&](AnimationCurve* curve) {
+            bool result = true;
+            visit_keys(*curve, settings, [&](const auto& values, const float tolerance) {
+                result = reproduces_key(*curve, values, anchor, candidate, k, tolerance);
+            });
+            return result;
+        });
+    };
+
+    std::vector<uint32_t> kept { 0 };
+    uint32_t anchor = 0;
+    for (uint32_t candidate = 2; candidate < key_count; candidate++) {
+        for (uint32_t k = anchor + 1; k < candidate; k++) {
+            if (!reproduced(anchor, candidate, k)) {
+                anchor = candidate - 1;
+                kept.push_back(anchor);
+                break;
+            }
+        }
+    }
+
+    // Linear curves need the last key to end their final segment, step curves only if it changes value.
+    const bool step = std::ranges::all_of(curves, [](const AnimationCurve* curve) { return curve->interpolation == Interpolation::Step; });
+    if (key_count > 1 && (!step || !reproduced(anchor, key_count - 1, key_count - 1))) {
+        kept.push_back(key_count - 1);
+    }
+    return kept;
+}
+
+// Removes keyframes that can be reconstructed within tolerance. Cubic spline curves are kept as-is
+// since their tangents would have to be refit. Curves keyed on the same timestamps are reduced
+// together and keep the same keys, so they still share one timeline once the clip is packed.
+export AnimationClip compress_animation_clip(AnimationClip clip, const CompressionSettings& settings) {
+    std::vector<std::vector<AnimationCurve*>> timelines;
+    for (AnimationCurve& curve: clip.curves) {
+        if (!is_reducible(curve)) continue;
+        const auto shared = std::ranges::find_if(timelines, [&](const std::vector<AnimationCurve*>& curves) {
+            return curves[0]->keyframe_timestamps == curve.keyframe_timestamps;
+        });
+        if (shared != timelines.end()) {
+            shared->push_back(&curve);
+        } else {
+            timelines.push_back({ &curve });
+        }
+    }
+
+    for (const std::vector<AnimationCurve*>& curves: timelines) {
+        const std::vector<uint32_t> kept = reduce_timeline(curves, settings);
+        for (AnimationCurve* curve: curves) {
+            visit_keys(*curve, settings, [&](auto& values, const float tolerance) {
+                // A curve that never leaves its first value is stored as a single key.
+                if (is_constant(values, tolerance)) {
+                    keep_keyframes(curve->keyframe_timestamps, values, { 0 });
+                } else {
+                    keep_keyframes(curve->keyframe_timestamps, values, kept);
+                }
+            });
+        }
+    }
+    return clip;
+}
@@ -0,0 +1,129 @@
+module;
+
+#include <vector>
+#include <variant>
+#include <cmath>
+#include <algorithm>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/compatibility.hpp>
+
+export module stellar.animation.resampling;
+
+import stellar.animation;
+import stellar.animation.compression;
+
+// Resamples curves to sample_rate keys per second. A curve is only replaced when the resampled
+// version stays within tolerance of the original (in scene units, radians for rotations);
+// otherwise it keeps its original keys.
+export struct ResampleSettings {
+    float sample_rate = 30.0f;
+    float tolerance = 0.001f;
+};
+
+template<typename T>
+T evaluate_curve(const AnimationCurve& curve, const std::vector<T>& values, const std::vector<T>& in_tangents, const std::vector<T>& out_tangents, const float time) {
+    const std::vector<float>& timestamps = curve.keyframe_timestamps;
+    if (values.size() == 1 || time <= timestamps.front()) {
+        return values.front();
+    }
+    if (time >= timestamps.back()) {
+        return values.back();
+    }
+
+    const uint32_t next = std::distance(timestamps.begin(), std::upper_bound(timestamps.begin(), timestamps.end(), time));
+    const uint32_t previous = next - 1;
+    const float dt = timestamps[next] - timestamps[previous];
+    const float s = (time - timestamps[previous]) / dt;
+    if (curve.interpolation == Interpolation::Step) {
+        return values[previous];
+    }
+    if (curve.interpolation == Interpolation::Linear) {
+        return interpolate_key(values[previous], values[next], s);
+    }
+
+    const float s2 = s * s;
+    const float s3 = s2 * s;
+    const T value = values[previous] * (2.0f * s3 - 3.0f * s2 + 1.0f)
+        + out_tangents[previous] * ((s3 - 2.0f * s2 + s) * dt)
+        + values[next] * (-2.0f * s3 + 3.0f * s2)
+        + in_tangents[next] * ((s3 - s2) * dt);
+    if constexpr (std::is_same_v<T, glm::quat>) {
+        return glm::normalize(value);
+    } else {
+        return value;
+    }
+}
+
+template<typename T>
+T evaluate_resampled(const std::vector<T>& samples, const float sample_rate, const float time) {
+    const float position = std::max(time * sample_rate, 0.0f);
+    const uint32_t previous = std::min(static_cast<uint32_t>(position), static_cast<uint32_t>(samples.size() - 1));
+    if (previous + 1 == samples.size()) {
+        return samples.back();
+    }
+    return interpolate_key(samples[previous], samples[previous + 1], position - previous);
+}
+
+template<typename K, typename T>
+void resample_curve(AnimationCurve& curve, K& frames, std::vector<T> K::* keys, const float duration, const ResampleSettings& settings) {
+    std::vector<T>& values = frames.*keys;
+    if (values.empty()) return;
+
+    const uint32_t sample_count = static_cast<uint32_t>(std::ceil(duration * settings.sample_rate)) + 1;
+    std::vector<T> samples;
+    samples.reserve(sample_count);
+    for (uint32_t k = 0; k < sample_count; k++) {
+        samples.push_back(evaluate_curve(curve, values, frames.in_tangents, frames.out_tangents, k / settings.sample_rate));
+    }
+
+    // Compare against the source at every original key and halfway between samples, where linear
+    // reconstruction drifts furthest from a spline.
+    float error = 0.0f;
+    for (const float time: curve.keyframe_timestamps) {
+        error = std::max(error, key_error(evaluate_resampled(samples, settings.sample_rate, time), evaluate_curve(curve, values, frames.in_tangents, frames.out_tangents, time)));
+    }
+    for (uint32_t k = 0; k + 1 < sample_count; k++) {
+        const float time = (k + 0.5f) / settings.sample_rate;
+        error = std::max(error, key_error(evaluate_resampled(samples, settings.sample_rate, time), evaluate_curve(curve, values, frames.in_tangents, frames.out_tangents, time)));
+    }
+
+    const bool constant = std::ranges::all_of(samples, [&](const T& sample) { return key_error(sample, samples.front()) <= settings.tolerance; });
+    if (constant && error <= settings.tolerance) {
+        curve.keyframe_timestamps = { 0.0f };
+        values = { samples.front() };
+        curve.sample_rate = 0.0f;
+    } else if (curve.interpolation != Interpolation::Step && error <= settings.tolerance) {
+        curve.keyframe_timestamps.resize(sample_count);
+        for (uint32_t k = 0; k < sample_count; k++) {
+            curve.keyframe_timestamps[k] = k / settings.sample_rate;
+        }
+        values = std::move(samples);
+        curve.sample_rate = settings.sample_rate;
+    } else {
+        return;
+    }
+    curve.interpolation = Interpolation::Linear;
+    frames.in_tangents.clear();
+    frames.out_tangents.clear();
+}
+
+// Resamples every curve of the clip to a fixed rate so the runtime finds keys with
+// floor(t * sample_rate) instead of a search. Curves that turn out constant collapse to one key.
+export AnimationClip resample_animation_clip(AnimationClip clip, const ResampleSettings& settings) {
+    for (AnimationCurve& curve: clip.curves) {
+        std::visit(
+            [&](auto&& arg) {
+                using T = std::decay_t<decltype(arg)>;
+                if constexpr (std::is_same_v<T, Keyframes::Rotation>) {
+                    resample_curve(curve, arg, &Keyframes::Rotation::rotations, clip.duration, settings);
+                } else if constexpr (std::is_same_v<T, Keyframes::Translation>) {
+                    resample_curve(curve, arg, &Keyframes::Translation::translations, clip.duration, settings);
+                } else if constexpr (std::is_same_v<T, Keyframes::Scale>) {
+                    resample_curve(curve, arg, &Keyframes::Scale::scales, clip.duration, settings);
+                }
+            },
+            curve.keyframes.frames
+        );
+    }
+    return clip;
+}
@@ -1,6 +1,15 @@
 module;
 
+#include <cstring>
 #include <filesystem>
+#include <limits>
+#include <optional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <execution>
 #include <fastgltf/core.hpp>
 #include <fastgltf/tools.hpp>
 #include <fastgltf/util.hpp>
@@ -8,6 +17,29 @@ module;
 #include <glm/vec2.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include <new>
+
+// stb_image allocates through ::operator new, so a decoded image can be handed to CPUTexture as is.
+static void* stbi_allocate(const size_t size) {
+    return ::operator new(size, std::nothrow);
+}
+
+static void* stbi_reallocate(void* pointer, const size_t old_size, const size_t new_size) {
+    void* result = ::operator new(new_size, std::nothrow);
+    if (result != nullptr && pointer != nullptr) {
+        memcpy(result, pointer, std::min(old_size, new_size));
+        ::operator delete(pointer);
+    }
+    return result;
+}
+
+static void stbi_deallocate(void* pointer) {
+    ::operator delete(pointer);
+}
+
+#define STBI_MALLOC(size) stbi_allocate(size)
+#define STBI_REALLOC_SIZED(pointer, old_size, new_size) stbi_reallocate(pointer, old_size, new_size)
+#define STBI_FREE(pointer) stbi_deallocate(pointer)
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
@@ -18,7 +50,10 @@ export module stellar.assets.gltf;
 import stellar.render.vulkan.plugin;
 import stellar.render.primitives;
 import stellar.animation;
+import stellar.animation.compression;
+import stellar.animation.resampling;
 import stellar.scene.transform;
+import stellar.assets.mapped_file;
 import stellar.core.result;
 import stellar.core;
 import stellar.render.types;
@@ -35,6 +70,9 @@ export struct GltfNode {
     Transform transform;
     std::vector<uint32_t> children;
     std::optional<uint32_t> parent;
+    uint32_t skeleton_joint = NO_JOINT;
+    // Initial morph target weights: the node's own, or else its mesh's defaults.
+    std::vector<float> weights;
 };
 
 export struct GltfJoint {
@@ -58,24 +96,395 @@ export struct Gltf {
     std::vector<GltfMaterial> materials;
     std::vector<GltfNode> nodes;
     std::vector<GltfJoint> joints;
-    std::vector<AnimationClip> animations;
+    std::vector<PackedAnimationClip> animations;
+    Skeleton skeleton;
     std::vector<uint32_t> top_nodes;
     std::vector<GltfSampler> samplers;
     std::vector<CPUTexture> textures;
 };
 
-export Result<Gltf, std::string> load_gltf(std::filesystem::path file_path) {
+export struct GltfLoadOptions {
+    CompressionSettings compression {};
+    // Resample animation curves to a fixed rate before compression. Off by default.
+    std::optional<ResampleSettings> resample {};
+    // Import against an existing rig: joints are matched to it by node name and clips are stored
+    // against its joint indices. Otherwise the file's skin joints and animated nodes form a new skeleton.
+    const Skeleton* skeleton = nullptr;
+    // Character files that share a rig can skip their clips and play ones imported once elsewhere.
+    bool animations = true;
+    // Read the file through a memory mapping rather than a heap copy of it. Turn it off for files on
+    // network shares, which can change under a mapping, or to compare the two.
+    bool memory_map = true;
+};
+
+constexpr uint32_t GLB_MAGIC = 0x46546C67;
+constexpr uint32_t GLB_BIN_CHUNK = 0x004E4942;
+constexpr fastgltf::CustomBufferId GLB_BUFFER_ID = std::numeric_limits<fastgltf::CustomBufferId>::max();
+
+// Feeds fastgltf straight from a mapped file instead of a heap copy of it. Buffers are handed out
+// through the parser's buffer allocation callback: the GLB binary chunk gets its own location in the
+// mapping, so fastgltf's copy into it reads and writes the same bytes and is skipped, and the chunk
+// is never duplicated. External buffers get a heap allocation each, as they did before.
+struct MappedGltfSource: fastgltf::GltfDataGetter {
+    MappedFile file{};
+    size_t offset = 0;
+    size_t glb_buffer_offset = 0;
+    size_t glb_buffer_size = 0;
+    bool glb_buffer_pending = false;
+    std::vector<std::unique_ptr<std::byte[]>> buffers{};
+    // simdjson reads past the end of the JSON, which needs a padded copy when the JSON ends the file.
+    std::vector<std::byte> padded{};
+
+    ~MappedGltfSource() override {
+        unmap_file(file);
+    }
+
+    void read(void* ptr, const std::size_t count) override {
+        const std::byte* source = file.data + offset;
+        if (ptr != source) {
+            memcpy(ptr, source, count);
+        }
+        offset += count;
+    }
+
+    fastgltf::span<std::byte> read(const std::size_t count, const std::size_t padding) override {
+        std::byte* bytes = const_cast<std::byte*>(file.data + offset);
+        if (offset + count + padding > file.size) {
+            padded.assign(count + padding, std::byte{0});
+            memcpy(padded.data(), bytes, count);
+            bytes = padded.data();
+        }
+        offset += count;
+        return fastgltf::span<std::byte>(bytes, count);
+    }
+
+    void reset() override {
+        offset = 0;
+    }
+
+    std::size_t bytesRead() override {
+        return offset;
+    }
+
+    std::size_t totalSize() override {
+        return file.size;
+    }
+
+    // Finds the binary chunk of a GLB, which follows the JSON chunk.
+    void find_glb_buffer() {
+        if (file.size < 20) return;
+        uint32_t header[3];
+        memcpy(header, file.data, sizeof(header));
+        if (header[0] != GLB_MAGIC) return;
+        uint32_t json_length;
+        memcpy(&json_length, file.data + 12, sizeof(json_length));
+        const size_t chunk_offset = 20 + static_cast<size_t>(json_length);
+        if (chunk_offset + 8 > file.size) return;
+        uint32_t chunk[2];
+        memcpy(chunk, file.data + chunk_offset, sizeof(chunk));
+        if (chunk[1] != GLB_BIN_CHUNK || chunk_offset + 8 + chunk[0] > file.size) return;
+
+        glb_buffer_offset = chunk_offset + 8;
+        glb_buffer_size = chunk[0];
+        glb_buffer_pending = true;
+    }
+
+    static fastgltf::BufferInfo allocate_buffer(const uint64_t size, void* user_pointer) {
+        auto* source = static_cast<MappedGltfSource*>(user_pointer);
+        // fastgltf asks for the binary chunk first, while reading the GLB container.
+        if (source->glb_buffer_pending && size == source->glb_buffer_size) {
+            source->glb_buffer_pending = false;
+            return fastgltf::BufferInfo {
+                .mappedMemory = const_cast<std::byte*>(source->file.data + source->glb_buffer_offset),
+                .customId = GLB_BUFFER_ID
+            };
+        }
+        source->buffers.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+        return fastgltf::BufferInfo {
+            .mappedMemory = source->buffers.back().get(),
+            .customId = source->buffers.size() - 1
+        };
+    }
+
+    // Swaps the custom buffers fastgltf created for views of their memory, which the default
+    // accessor tools and the image decoding read directly.
+    void resolve_buffers(fastgltf::Asset& asset) const {
+        for (fastgltf::Buffer& buffer: asset.buffers) {
+            const auto* custom = std::get_if<fastgltf::sources::CustomBuffer>(&buffer.data);
+            if (custom == nullptr) continue;
+            const std::byte* bytes = custom->id == GLB_BUFFER_ID ? file.data + glb_buffer_offset : buffers[custom->id].get();
+            buffer.data = fastgltf::sources::ByteView {
+                .bytes = fastgltf::span<const std::byte>(bytes, buffer.byteLength),
+                .mimeType = fastgltf::MimeType::GltfBuffer
+            };
+        }
+    }
+};
+
+// Cubic spline samplers store (in-tangent, value, out-tangent) triples in their output accessor.
+template<typename T>
+void push_keyframe(const T& value, const size_t index, const bool cubic, std::vector<T>& values, std::vector<T>& in_tangents, std::vector<T>& out_tangents) {
+    if (!cubic) {
+        values.push_back(value);
+        return;
+    }
+    switch (index % 3) {
+        case 0:
+            in_tangents.push_back(value);
+            break;
+        case 1:
+            values.push_back(value);
+            break;
+        case 2:
+            out_tangents.push_back(value);
+            break;
+    }
+}
+
+// Decodes one texture's embedded image, or nothing when stb_image cannot read it.
+std::optional<CPUTexture> load_texture(const fastgltf::Asset& gltf, const fastgltf::Texture& texture) {
+    std::optional<CPUTexture> result;
+    const fastgltf::Image& image = gltf.images[texture.imageIndex.value()];
+    std::visit(fastgltf::visitor {
+        [&](const fastgltf::sources::BufferView& view) {
+            const fastgltf::BufferView& buffer_view = gltf.bufferViews[view.bufferViewIndex];
+            const fastgltf::Buffer& buffer = gltf.buffers[buffer_view.bufferIndex];
+
+            // Decoded straight from the mapped file, or from the heap copy of it without a mapping.
+            const std::byte* bytes = std::visit(fastgltf::visitor {
+                [](const fastgltf::sources::ByteView& source) { return source.bytes.data(); },
+                [](const fastgltf::sources::Array& source) { return static_cast<const std::byte*>(source.bytes.data()); },
+                [](auto& arg) -> const std::byte* { unreachable(); }
+            }, buffer.data);
+
+            int width, height, channels;
+            const auto* encoded = reinterpret_cast<const stbi_uc*>(bytes + buffer_view.byteOffset);
+            uint8_t* buffer_data = stbi_load_from_memory(encoded, buffer_view.byteLength, &width, &height, &channels, 4);
+            if (buffer_data) {
+                // The texture takes over the decoded pixels rather than a copy of them.
+                result = CPUTexture {
+                    .data = std::unique_ptr<uint8_t[], PixelDeleter>(buffer_data),
+                    .width = static_cast<uint32_t>(width),
+                    .height = static_cast<uint32_t>(height)
+                };
+            }
+        },
+        [](auto& arg) { unreachable(); }
+    }, image.data);
+    return result;
+}
+
+PackedAnimationClip load_animation(const fastgltf::Asset& gltf, const fastgltf::Animation& animation, const RetargetTable& retarget_table, const GltfLoadOptions& options) {
+    std::vector<AnimationCurve> curves;
+    float duration = 0;
+    for (const fastgltf::AnimationChannel& channel: animation.channels) {
+        const fastgltf::AnimationSampler& sampler = animation.samplers[channel.samplerIndex];
+        const fastgltf::Accessor& output_accessor = gltf.accessors[sampler.outputAccessor];
+        const fastgltf::Accessor& input_accessor = gltf.accessors[sampler.inputAccessor];
+
+        AnimationCurve& curve = curves.emplace_back();
+        curve.joint_index = channel.nodeIndex.value();
+
+        fastgltf::iterateAccessor<float>(gltf, input_accessor, [&](float v) {
+            curve.keyframe_timestamps.push_back(v);
+        });
+        duration = std::max(*std::ranges::max_element(curve.keyframe_timestamps.begin(), curve.keyframe_timestamps.end()), duration);
+        
+        const bool cubic = sampler.interpolation == fastgltf::AnimationInterpolation::CubicSpline;
+        if (channel.path == fastgltf::AnimationPath::Rotation) {
+            Keyframes::Rotation frames;
+            fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, output_accessor, [&](glm::vec4 v, size_t index) {
+                glm::quat quat(v[3], v[0], v[1], v[2]);
+                push_keyframe(quat, index, cubic, frames.rotations, frames.in_tangents, frames.out_tangents);
+            });
+            curve.keyframes.frames = frames;
+        } else if (channel.path == fastgltf::AnimationPath::Scale) {
+            Keyframes::Scale frames;
+            fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, output_accessor, [&](glm::vec3 v, size_t index) {
+                push_keyframe(v, index, cubic, frames.scales, frames.in_tangents, frames.out_tangents);
+            });
+            curve.keyframes.frames = frames;
+        } else if (channel.path == fastgltf::AnimationPath::Translation) {
+            Keyframes::Translation frames;
+            fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, output_accessor, [&](glm::vec3 v, size_t index) {
+                push_keyframe(v, index, cubic, frames.translations, frames.in_tangents, frames.out_tangents);
+            });
+            curve.keyframes.frames = frames;
+        } else if (channel.path == fastgltf::AnimationPath::Weights) {
+            // Each key holds one weight per morph target; cubic keys are (in-tangents, values, out-tangents).
+            Keyframes::Weights frames {
+                .count = static_cast<uint32_t>(output_accessor.count / (curve.keyframe_timestamps.size() * (cubic ? 3 : 1)))
+            };
+            fastgltf::iterateAccessorWithIndex<float>(gltf, output_accessor, [&](float v, size_t index) {
+                if (!cubic || (index / frames.count) % 3 == 1) {
+                    frames.weights.push_back(v);
+                }
+            });
+            curve.keyframes.frames = frames;
+        }
+
+        if (sampler.interpolation == fastgltf::AnimationInterpolation::Linear) {
+            curve.interpolation = Interpolation::Linear;
+        } else if (sampler.interpolation == fastgltf::AnimationInterpolation::Step) {
+            curve.interpolation = Interpolation::Step;
+        } else if (sampler.interpolation == fastgltf::AnimationInterpolation::CubicSpline) {
+            curve.interpolation = Interpolation::CubicSpline;
+        }
+    }
+    AnimationClip clip = retarget_animation_clip(AnimationClip {
+        .curves = std::move(curves),
+        .duration = duration
+    }, retarget_table);
+    if (options.resample) {
+        clip = resample_animation_clip(std::move(clip), *options.resample);
+    }
+    return pack_animation_clip(compress_animation_clip(std::move(clip), options.compression));
+}
+
+GltfMesh load_mesh(const fastgltf::Asset& gltf, const fastgltf::Mesh& gltf_mesh) {
+    std::vector<Vertex> vertices{};
+    std::vector<uint32_t> indices{};
+    std::vector<MorphTarget> morph_targets{};
+
+    // Sized up front, so growing them never holds two copies of the geometry at once.
+    size_t vertex_total = 0;
+    size_t index_total = 0;
+    for (const fastgltf::Primitive& p: gltf_mesh.primitives) {
+        vertex_total += gltf.accessors[p.findAttribute("POSITION")->second].count;
+        index_total += gltf.accessors[p.indicesAccessor.value()].count;
+    }
+    vertices.reserve(vertex_total);
+    indices.reserve(index_total);
+
+    for (const fastgltf::Primitive& p: gltf_mesh.primitives) {
+        size_t initial_vertex = vertices.size();
+        {
+            const fastgltf::Accessor& index_accessor = gltf.accessors[p.indicesAccessor.value()];
+            fastgltf::iterateAccessor<uint32_t>(gltf, index_accessor, [&](uint32_t idx) {
+                indices.push_back(idx + initial_vertex); 
+            });
+        }
+        {
+            const fastgltf::Accessor& position_accessor = gltf.accessors[p.findAttribute("POSITION")->second];
+            fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, position_accessor, [&](const glm::vec3 v, size_t index) {
+                const Vertex vertex {
+                    .position = glm::vec4(v, 1.0f),
+                    .normal = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
+                    .uv = glm::vec2(0.0f, 0.0f)
+                };
+                vertices.push_back(vertex);
+            });
+        }
+
+        auto normals = p.findAttribute("NORMAL");
+        if (normals != p.attributes.end()) {
+            fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[normals->second], [&](glm::vec3 v, size_t index) {
+                vertices[initial_vertex + index].normal = glm::vec4(v, 0.0f); 
+            });
+        }
+
+        auto uv = p.findAttribute("TEXCOORD_0");
+        if (uv != p.attributes.end()) {
+            fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[uv->second], [&](glm::vec2 v, size_t index) {
+                vertices[initial_vertex + index].uv = v; 
+            });
+        }
+
+        auto joints_attribute = p.findAttribute("JOINTS_0");
+        if (joints_attribute != p.attributes.end()) {
+            fastgltf::iterateAccessorWithIndex<glm::uvec4>(gltf, gltf.accessors[joints_attribute->second], [&](glm::uvec4 v, size_t index) {
+                 vertices[initial_vertex + index].joints = v;
+            });
+        }
+
+        auto weights = p.findAttribute("WEIGHTS_0");
+        if (weights != p.attributes.end()) {
+            fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[weights->second], [&](glm::vec4 v, size_t index) {
+                vertices[initial_vertex + index].weights = v;
+            });
+        }
+
+        // Morph targets are kept sparse: only vertices with a non-zero delta are stored.
+        const size_t vertex_count = vertices.size() - initial_vertex;
+        morph_targets.resize(std::max(morph_targets.size(), p.targets.size()));
+        for (size_t t = 0; t < p.targets.size(); t++) {
+            std::vector<glm::vec3> position_deltas(vertex_count, glm::vec3(0.0f));
+            std::vector<glm::vec3> normal_deltas(vertex_count, glm::vec3(0.0f));
+            if (auto position = p.findTargetAttribute(t, "POSITION"); position != p.targets[t].end()) {
+                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[position->second], [&](glm::vec3 v, size_t index) {
+                    position_deltas[index] = v;
+                });
+            }
+            if (auto normal = p.findTargetAttribute(t, "NORMAL"); normal != p.targets[t].end()) {
+                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[normal->second], [&](glm::vec3 v, size_t index) {
+                    normal_deltas[index] = v;
+                });
+            }
+
+            MorphTarget& target = morph_targets[t];
+            for (uint32_t v = 0; v < vertex_count; v++) {
+                if (position_deltas[v] == glm::vec3(0.0f) && normal_deltas[v] == glm::vec3(0.0f)) continue;
+                target.vertices.push_back(initial_vertex + v);
+                target.position_deltas.push_back(position_deltas[v]);
+                target.normal_deltas.push_back(normal_deltas[v]);
+            }
+        }
+    }
+
+    return GltfMesh {
+        .mesh = Mesh {
+            .vertices = std::move(vertices),
+            .indices = std::move(indices),
+            .morph_targets = std::move(morph_targets)
+        },
+        .material = static_cast<uint32_t>(gltf_mesh.primitives[0].materialIndex.value_or(0))
+    };
+}
+
+export Result<Gltf, std::string> load_gltf(std::filesystem::path file_path, const GltfLoadOptions& options = {}) {
     fastgltf::Parser parser{};
     constexpr auto gltf_options = fastgltf::Options::DontRequireValidAssetMember
         | fastgltf::Options::AllowDouble
         | fastgltf::Options::LoadExternalBuffers
         | fastgltf::Options::LoadExternalImages;
 
-    auto data = fastgltf::GltfDataBuffer::FromPath(file_path);
+    // The mapping or buffer has to outlive every read of the asset's buffers, which all happen in here.
+    MappedGltfSource mapped_data{};
+    std::optional<fastgltf::GltfDataBuffer> buffered_data;
+    fastgltf::GltfDataGetter* data = nullptr;
+    if (options.memory_map) {
+        auto mapped = map_file(file_path);
+        if (mapped.is_err()) {
+            return Err(mapped.unwrap_err());
+        }
+        mapped_data.file = std::move(mapped).unwrap();
+        mapped_data.find_glb_buffer();
+        // The container and JSON are parsed front to back. The binary chunk is read by meshes,
+        // animations and images decoded in parallel, in no fixed order, so readahead there only
+        // pulls in pages nobody asked for yet.
+        if (mapped_data.glb_buffer_pending) {
+            advise_mapped_file(mapped_data.file, mapped_data.glb_buffer_offset, mapped_data.glb_buffer_size, AccessPattern::Random);
+            advise_mapped_file(mapped_data.file, 0, mapped_data.glb_buffer_offset, AccessPattern::Sequential);
+        } else {
+            advise_mapped_file(mapped_data.file, 0, mapped_data.file.size, AccessPattern::Sequential);
+        }
+        parser.setUserPointer(&mapped_data);
+        parser.setBufferAllocationCallback(MappedGltfSource::allocate_buffer);
+        data = &mapped_data;
+    } else {
+        auto buffer = fastgltf::GltfDataBuffer::FromPath(file_path);
+        if (buffer.error() != fastgltf::Error::None) {
+            return Err(std::string(fastgltf::getErrorMessage(buffer.error())));
+        }
+        buffered_data = std::move(buffer.get());
+        data = &buffered_data.value();
+    }
+
     fastgltf::Asset gltf;
-    fastgltf::GltfType type = fastgltf::determineGltfFileType(data.get());
+    fastgltf::GltfType type = fastgltf::determineGltfFileType(*data);
+    data->reset();
     if (type == fastgltf::GltfType::glTF) {
-        auto load = parser.loadGltf(data.get(), file_path.parent_path(), gltf_options);
+        auto load = parser.loadGltf(*data, file_path.parent_path(), gltf_options);
         if (load) {
             gltf = std::move(load.get());
         } else {
@@ -83,7 +492,7 @@ export Result<Gltf, std::string> load_gltf(std::filesystem::path file_path) {
             return Err(msg);
         }
     } else if (type == fastgltf::GltfType::GLB) {
-        auto load = parser.loadGltfBinary(data.get(), file_path.parent_path(), gltf_options);
+        auto load = parser.loadGltfBinary(*data, file_path.parent_path(), gltf_options);
         if (load) {
             gltf = std::move(load.get());
         } else {
@@ -93,13 +502,16 @@ export Result<Gltf, std::string> load_gltf(std::filesystem::path file_path) {
     } else {
         return Err(std::string("Failed to determine gltf type"));
     }
+    if (options.memory_map) {
+        mapped_data.resolve_buffers(gltf);
+    }
 
     std::vector<GltfMaterial> materials;
     std::vector<GltfMesh> meshes;
     std::vector<GltfNode> nodes;
     std::vector<uint32_t> top_nodes;
     std::vector<GltfJoint> joints;
-    std::vector<AnimationClip> animations;
+    std::vector<PackedAnimationClip> animations;
     std::vector<GltfSampler> samplers;
     std::vector<CPUTexture> textures;
 
@@ -136,85 +548,56 @@ export Result<Gltf, std::string> load_gltf(std::filesystem::path file_path) {
         });
     }
 
-    for (fastgltf::Texture& texture: gltf.textures) {
-        const fastgltf::Image& image = gltf.images[texture.imageIndex.value()];
-        std::visit(fastgltf::visitor {
-            [&](fastgltf::sources::BufferView view) {
-                const fastgltf::BufferView& buffer_view = gltf.bufferViews[view.bufferViewIndex];
-                const fastgltf::Buffer& buffer = gltf.buffers[buffer_view.bufferIndex];
-
-                std::visit(fastgltf::visitor {
-                    [&](const fastgltf::sources::Array& array) {
-                        int width, height, channels;
-                        uint8_t* buffer_data = stbi_load_from_memory(array.bytes.data() + buffer_view.byteOffset, buffer_view.byteLength, &width, &height, &channels, 4);
-                        if (buffer_data) {
-                            std::vector<uint8_t> image_data(width * height * 4);
-                            memcpy(image_data.data(), buffer_data, width * height * 4);
-                            stbi_image_free(buffer_data);
-                            textures.push_back(CPUTexture {
-                                .data = std::move(image_data),
-                                .width = static_cast<uint32_t>(width),
-                                .height = static_cast<uint32_t>(height)
-                            });
-                        }
-                    },
-                    [](auto& arg) { unreachable(); }
-                }, buffer.data);
-            },
-            [](auto& arg) { unreachable(); }
-        }, image.data);
-    }
-    
-    for (fastgltf::Animation& animation: gltf.animations) {
-        std::vector<std::vector<AnimationCurve>> curves(gltf.nodes.size());
-        float duration = 0;
-        for (fastgltf::AnimationChannel& channel: animation.channels) {
-            fastgltf::AnimationSampler& sampler = animation.samplers[channel.samplerIndex];
-            fastgltf::Accessor& output_accessor = gltf.accessors[sampler.outputAccessor];
-            fastgltf::Accessor& input_accessor = gltf.accessors[sampler.inputAccessor];
-            
-            AnimationCurve& curve = curves[channel.nodeIndex.value()].emplace_back();
-
-            fastgltf::iterateAccessor<float>(gltf, input_accessor, [&](float v) {
-                curve.keyframe_timestamps.push_back(v);
-            });
-            duration = std::max(*std::ranges::max_element(curve.keyframe_timestamps.begin(), curve.keyframe_timestamps.end()), duration);
-            
-            if (channel.path == fastgltf::AnimationPath::Rotation) {
-                std::vector<glm::quat> rotations;
-                fastgltf::iterateAccessor<glm::vec4>(gltf, output_accessor, [&](glm::vec4 v) {
-                    glm::quat quat(v[3], v[0], v[1], v[2]);
-                    rotations.push_back(quat);
-                });
-                curve.keyframes.frames = Keyframes::Rotation { rotations };
-            } else if (channel.path == fastgltf::AnimationPath::Scale) {
-                std::vector<glm::vec3> scales;
-                fastgltf::iterateAccessor<glm::vec3>(gltf, output_accessor, [&](glm::vec3 v) {
-                    scales.push_back(v); 
-                });
-                curve.keyframes.frames = Keyframes::Scale { scales };
-            } else if (channel.path == fastgltf::AnimationPath::Translation) {
-                std::vector<glm::vec3> translations;
-                fastgltf::iterateAccessor<glm::vec3>(gltf, output_accessor, [&](glm::vec3 v) {
-                    translations.push_back(v);
-                });
-                curve.keyframes.frames = Keyframes::Translation { translations };
-            }
+    // Skin joints and animated nodes make up the rig. Unnamed ones keep an empty name, so they are
+    // never matched to a joint of another file.
+    std::vector<std::optional<std::string>> node_names(gltf.nodes.size());
+    const auto name_node = [&](const size_t index) {
+        node_names[index] = std::string(gltf.nodes[index].name);
+    };
+    for (const fastgltf::Skin& skin: gltf.skins) {
+        for (const size_t joint: skin.joints) {
+            name_node(joint);
+        }
+    }
+    for (const fastgltf::Animation& animation: gltf.animations) {
+        for (const fastgltf::AnimationChannel& channel: animation.channels) {
+            name_node(channel.nodeIndex.value());
+        }
+    }
+    Skeleton skeleton = options.skeleton != nullptr ? *options.skeleton : Skeleton {};
+    auto retarget_result = build_retarget_table(skeleton, node_names, options.skeleton == nullptr);
+    if (retarget_result.is_err()) {
+        return Err(std::move(retarget_result).unwrap_err());
+    }
+    const RetargetTable retarget_table = std::move(retarget_result).unwrap();
+
+    // Texture decodes, clips and meshes only read the parsed asset, so each one is an independent
+    // task. Results land in slots indexed like the asset's own arrays and are joined in order below,
+    // so the output does not depend on scheduling.
+    std::vector<std::optional<CPUTexture>> decoded_textures(gltf.textures.size());
+    animations.resize(options.animations ? gltf.animations.size() : 0);
+    meshes.resize(gltf.meshes.size());
+
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(decoded_textures.size() + animations.size() + meshes.size());
+    for (size_t i = 0; i < decoded_textures.size(); i++) {
+        tasks.emplace_back([&, i] { decoded_textures[i] = load_texture(gltf, gltf.textures[i]); });
+    }
+    for (size_t i = 0; i < animations.size(); i++) {
+        tasks.emplace_back([&, i] { animations[i] = load_animation(gltf, gltf.animations[i], retarget_table, options); });
+    }
+    for (size_t i = 0; i < meshes.size(); i++) {
+        tasks.emplace_back([&, i] { meshes[i] = load_mesh(gltf, gltf.meshes[i]); });
+    }
+    std::for_each(std::execution::par, tasks.begin(), tasks.end(), [](const std::function<void()>& task) { task(); });
 
-            if (sampler.interpolation == fastgltf::AnimationInterpolation::Linear) {
-                curve.interpolation = Interpolation::Linear;
-            } else if (sampler.interpolation == fastgltf::AnimationInterpolation::Step) {
-                curve.interpolation = Interpolation::Step;
-            } else if (sampler.interpolation == fastgltf::AnimationInterpolation::CubicSpline) {
-                curve.interpolation = Interpolation::CubicSpline;
-            }
+    // Images stb_image cannot decode are dropped, as they always were.
+    for (std::optional<CPUTexture>& texture: decoded_textures) {
+        if (texture.has_value()) {
+            textures.push_back(std::move(texture.value()));
         }
-        animations.push_back(AnimationClip {
-            .curves = curves,
-            .duration = duration
-        });
     }
-    
+
     for (fastgltf::Material& mat: gltf.materials) {
         GltfMaterial& material = materials.emplace_back();
         material.color[0] = mat.pbrData.baseColorFactor[0];
@@ -240,68 +623,6 @@ export Result<Gltf, std::string> load_gltf(std::filesystem::path file_path) {
         });
     }
 
-    for (fastgltf::Mesh& gltf_mesh: gltf.meshes) {
-        std::vector<Vertex> vertices{};
-        std::vector<uint32_t> indices{};
-
-        for (auto&& p: gltf_mesh.primitives) {
-            size_t initial_vertex = vertices.size();
-            {
-                fastgltf::Accessor& index_accessor = gltf.accessors[p.indicesAccessor.value()];
-                fastgltf::iterateAccessor<uint32_t>(gltf, index_accessor, [&](uint32_t idx) {
-                    indices.push_back(idx + initial_vertex); 
-                });
-            }
-            {
-                fastgltf::Accessor& position_accessor = gltf.accessors[p.findAttribute("POSITION")->second];
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, position_accessor, [&](const glm::vec3 v, size_t index) {
-                    const Vertex vertex {
-                        .position = glm::vec4(v, 1.0f),
-                        .normal = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
-                        .uv = glm::vec2(0.0f, 0.0f)
-                    };
-                    vertices.push_back(vertex);
-                });
-            }
-
-            auto normals = p.findAttribute("NORMAL");
-            if (normals != p.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[normals->second], [&](glm::vec3 v, size_t index) {
-                    vertices[initial_vertex + index].normal = glm::vec4(v, 0.0f); 
-                });
-            }
-
-            auto uv = p.findAttribute("TEXCOORD_0");
-            if (uv != p.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[uv->second], [&](glm::vec2 v, size_t index) {
-                    vertices[initial_vertex + index].uv = v; 
-                });
-            }
-
-            auto joints_attribute = p.findAttribute("JOINTS_0");
-            if (joints_attribute != p.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::uvec4>(gltf, gltf.accessors[joints_attribute->second], [&](glm::uvec4 v, size_t index) {
-                     vertices[initial_vertex + index].joints = v;
-                });
-            }
-
-            auto weights = p.findAttribute("WEIGHTS_0");
-            if (weights != p.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[weights->second], [&](glm::vec4 v, size_t index) {
-                    vertices[initial_vertex + index].weights = v;
-                });
-            }
-        }
-
-        meshes.push_back(GltfMesh {
-            .mesh = Mesh {
-                .vertices = vertices,
-                .indices = indices
-            },
-            .material = static_cast<uint32_t>(gltf_mesh.primitives[0].materialIndex.value_or(0))
-        });
-    }
-
     for (uint32_t i = 0; i < gltf.nodes.size(); i++) {
         GltfNode& node = nodes.emplace_back();
         if (gltf.nodes[i].meshIndex.has_value()) {
@@ -310,6 +631,13 @@ export Result<Gltf, std::string> load_gltf(std::filesystem::path file_path) {
         if (gltf.nodes[i].skinIndex.has_value()) {
             node.skin = gltf.nodes[i].skinIndex.value();
         }
+        node.skeleton_joint = retarget_table.find_joint(i);
+        if (!gltf.nodes[i].weights.empty()) {
+            node.weights.assign(gltf.nodes[i].weights.begin(), gltf.nodes[i].weights.end());
+        } else if (node.mesh.has_value()) {
+            const fastgltf::Mesh& mesh = gltf.meshes[node.mesh.value()];
+            node.weights.assign(mesh.weights.begin(), mesh.weights.end());
+        }
 
         std::visit(
             fastgltf::visitor{
@@ -354,13 +682,14 @@ export Result<Gltf, std::string> load_gltf(std::filesystem::path file_path) {
     }
 
     return Ok(Gltf {
-        .meshes = meshes,
-        .materials = materials,
-        .nodes = nodes,
-        .joints = joints,
-        .animations = animations,
-        .top_nodes = top_nodes,
-        .samplers = samplers,
-        .textures = textures,
+        .meshes = std::move(meshes),
+        .materials = std::move(materials),
+        .nodes = std::move(nodes),
+        .joints = std::move(joints),
+        .animations = std::move(animations),
+        .skeleton = std::move(skeleton),
+        .top_nodes = std::move(top_nodes),
+        .samplers = std::move(samplers),
+        .textures = std::move(textures),
     });
 }
\ No newline at end of file
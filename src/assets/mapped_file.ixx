@@ -0,0 +1,132 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+#include <span>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+export module stellar.assets.mapped_file;
+
+import stellar.core.result;
+
+// A read-only view of a whole file, backed by the page cache instead of a heap copy. Pages are read
+// in on first touch and, being clean, can be dropped again by the OS under memory pressure.
+export struct MappedFile {
+    const std::byte* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    std::span<const std::byte> bytes() const {
+        return { data, size };
+    }
+};
+
+export enum class AccessPattern {
+    Sequential,
+    Random,
+};
+
+export void unmap_file(MappedFile& file) {
+#ifdef _WIN32
+    if (file.data != nullptr) UnmapViewOfFile(file.data);
+    if (file.mapping != nullptr) CloseHandle(file.mapping);
+    if (file.file != INVALID_HANDLE_VALUE) CloseHandle(file.file);
+    file.file = INVALID_HANDLE_VALUE;
+    file.mapping = nullptr;
+#else
+    if (file.data != nullptr) munmap(const_cast<std::byte*>(file.data), file.size);
+#endif
+    file.data = nullptr;
+    file.size = 0;
+}
+
+export Result<MappedFile, std::string> map_file(const std::filesystem::path& path) {
+    MappedFile file{};
+#ifdef _WIN32
+    file.file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file.file == INVALID_HANDLE_VALUE) {
+        return Err("Failed to open " + path.string());
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file.file, &size)) {
+        unmap_file(file);
+        return Err("Failed to get the size of " + path.string());
+    }
+    file.size = static_cast<size_t>(size.QuadPart);
+    if (file.size == 0) return Ok(file);
+
+    file.mapping = CreateFileMappingW(file.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (file.mapping != nullptr) {
+        file.data = static_cast<const std::byte*>(MapViewOfFile(file.mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (file.data == nullptr) {
+        unmap_file(file);
+        return Err("Failed to map " + path.string());
+    }
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Err("Failed to open " + path.string());
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return Err("Failed to get the size of " + path.string());
+    }
+    file.size = static_cast<size_t>(info.st_size);
+    if (file.size == 0) {
+        close(fd);
+        return Ok(file);
+    }
+
+    // The mapping holds its own reference to the file, so the descriptor can be closed right away.
+    void* data = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        file.size = 0;
+        return Err("Failed to map " + path.string());
+    }
+    file.data = static_cast<const std::byte*>(data);
+#endif
+    return Ok(file);
+}
+
+// Hints how [offset, offset + size) of the file is about to be read, and starts reading it in.
+export void advise_mapped_file(const MappedFile& file, const size_t offset, const size_t size, const AccessPattern pattern) {
+    if (file.data == nullptr || offset >= file.size) return;
+    const size_t length = std::min(size, file.size - offset);
+#ifdef _WIN32
+    // Mapped views take no access pattern hints on Windows; prefetching is the closest equivalent.
+    if (pattern == AccessPattern::Sequential) {
+        WIN32_MEMORY_RANGE_ENTRY range { const_cast<std::byte*>(file.data + offset), length };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t aligned_offset = offset - offset % page_size;
+    void* start = const_cast<std::byte*>(file.data + aligned_offset);
+    const size_t aligned_length = length + (offset - aligned_offset);
+    if (pattern == AccessPattern::Sequential) {
+        madvise(start, aligned_length, MADV_SEQUENTIAL);
+        madvise(start, aligned_length, MADV_WILLNEED);
+    } else {
+        madvise(start, aligned_length, MADV_RANDOM);
+    }
+#endif
+}
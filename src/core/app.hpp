@@ -7,6 +7,7 @@
 #include <optional>
 #include <vector>
 #include <unordered_map>
+#include <thread>
 
 import stellar.render.vulkan.plugin;
 import stellar.window;
@@ -24,6 +25,7 @@ struct App {
 
     void initialize() {
         flecs::log::set_level(2);
+        world.set_threads(std::thread::hardware_concurrency());
 
         initialize_window(world, 1280, 960);
         initialize_vulkan(world);
@@ -43,8 +45,9 @@ struct App {
             flecs::entity entity = world.entity().set<CPUSampler>(CPUSampler { .min_filter = sampler.min_filter, .mag_filter = sampler.mag_filter });
             samplers.push_back(entity);
         }
-        for (const auto& texture: gltf.textures) {
-            flecs::entity entity = world.entity().set<CPUTexture>(texture);
+        // Pixels, vertices and clips are moved into their components; gltf only keeps the emptied shells.
+        for (auto& texture: gltf.textures) {
+            flecs::entity entity = world.entity().emplace<CPUTexture>(std::move(texture));
             textures.push_back(entity);
         }
         for (const auto& gltf_material: gltf.materials) {
@@ -56,8 +59,8 @@ struct App {
             flecs::entity entity = world.entity().set<Material>(material);
             materials.push_back(entity);
         }
-        for (const auto& mesh: gltf.meshes) {
-            flecs::entity entity = world.entity().set<Mesh>(mesh.mesh);
+        for (auto& mesh: gltf.meshes) {
+            flecs::entity entity = world.entity().emplace<Mesh>(std::move(mesh.mesh));
             meshes.push_back(entity);
         }
 
@@ -75,8 +78,8 @@ struct App {
         }
         top_entities[1].add<Character>();
 
-        flecs::entity animation = world.entity().set<AnimationClip>(gltf.animations[0]);
-        flecs::entity player = world.entity<AnimationPlayer>().set<AnimationPlayer>(AnimationPlayer {
+        flecs::entity animation = world.entity().emplace<PackedAnimationClip>(std::move(gltf.animations[0]));
+        flecs::entity player = top_entities[1].set<AnimationPlayer>(AnimationPlayer {
             .animation = animation,
             .active_animation = ActiveAnimation {
                 .speed = 1.0,
@@ -84,6 +87,10 @@ struct App {
                 .seek_time = 0,
             }
         });
+        // The demo character is the only one on screen and the camera follows it from a fixed offset,
+        // so it is always animated at full rate. Crowds add AnimationLod with a radius fitted to the
+        // model, as LOD distances are measured in multiples of it.
+        bind_animation_targets(player);
 
         world.observer<Window>()
             .term_at(0).singleton()
@@ -95,7 +102,6 @@ struct App {
             });
 
         world.observer<AnimationPlayer>()
-            .term_at(0).singleton()
             .event<KeyboardEvent>()
             .each([](flecs::iter& it, size_t i, AnimationPlayer& player) {
                 KeyboardEvent* event = static_cast<KeyboardEvent*>(it.param());
@@ -108,16 +114,20 @@ struct App {
                 }
             });
 
-        world.observer<Transform>().with<Character>()
+        // The character may be split into Translation/Rotation/Scale, so move it through its local transform.
+        world.observer().with<Character>()
             .event<KeyboardEvent>()
-            .each([](flecs::iter& it, size_t i, Transform& transform) {
+            .each([](flecs::iter& it, size_t i) {
                 KeyboardEvent* event = static_cast<KeyboardEvent*>(it.param());
                 if (event->key == Key::KeyW) {
+                    const flecs::entity character = it.entity(i);
+                    Transform transform = local_transform(character);
                     transform.translation.z += (15.0f * it.world().delta_time());
+                    set_local_transform(character, transform);
                 }
             });
 
-        world.entity("Camera")
+        flecs::entity camera = world.entity("Camera")
             .set<Camera>(Camera {
                 .projection = glm::perspectiveLH(glm::radians(60.0f), 1280.0f / 960.0f, 10000.0f, 0.01f)
             })
@@ -127,6 +137,7 @@ struct App {
                 .scale = glm::vec3(1.0, 1.0, 1.0)
             })
             .child_of(top_entities[1]);
+        world.get_mut<AnimationLodSettings>()->viewer = camera;
     }
 
     void run() {
@@ -151,6 +162,13 @@ struct App {
         if (node.mesh.has_value()) {
             GltfMesh& mesh = gltf.meshes[node.mesh.value()];
             entity.is_a(meshes[node.mesh.value()]).is_a(materials[mesh.material]);
+            // The vertex data already moved into the mesh entity.
+            const Mesh* instance_mesh = meshes[node.mesh.value()].get<Mesh>();
+            if (!instance_mesh->morph_targets.empty()) {
+                MorphWeights weights { .weights = node.weights };
+                weights.weights.resize(instance_mesh->morph_targets.size(), 0.0f);
+                entity.set<MorphWeights>(weights);
+            }
         }
         if (node.joint.has_value()) {
             GltfJoint& joint = gltf.joints[node.joint.value()];
@@ -165,7 +183,13 @@ struct App {
             entity.child_of(parent.value());
         }
         
-        entity.set<Transform>(node.transform).set<AnimationTarget>(AnimationTarget { index });
+        entity.set<Transform>(node.transform);
+        if (node.skeleton_joint != NO_JOINT) {
+            entity.set<AnimationTarget>(AnimationTarget {
+                .joint_index = node.skeleton_joint,
+                .rest = node.transform
+            });
+        }
         for (const auto& c: node.children) {
             spawn_node(gltf, c, entity, materials, meshes, joints, entity_to_skin);
         }
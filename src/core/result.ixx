@@ -52,16 +52,14 @@ struct Result {
     [[nodiscard]] constexpr bool is_ok() const noexcept { return std::holds_alternative<OkT>(value); }
     [[nodiscard]] constexpr bool is_err() const noexcept { return std::holds_alternative<ErrT>(value); }
 
-    constexpr T unwrap() requires !std::is_void_v<T> {
+    // Unwrapping a temporary, such as load_gltf(path).unwrap(), moves the value out; unwrapping a
+    // named Result copies it and leaves the Result intact. std::move(result).unwrap() moves.
+    constexpr T unwrap() && requires !std::is_void_v<T> {
         if (is_err()) throw std::bad_variant_access();
         return std::get<OkT>(std::move(value)).value;
     }
 
-    constexpr void unwrap() requires std::is_void_v<T> {
-        if (is_err()) throw std::bad_variant_access();
-    }
-
-    constexpr T unwrap() const requires !std::is_void_v<T> {
+    constexpr T unwrap() const& requires !std::is_void_v<T> {
         if (is_err()) throw std::bad_variant_access();
         return std::get<OkT>(value).value;
     }
@@ -70,17 +68,17 @@ struct Result {
         if (is_err()) throw std::bad_variant_access();
     }
 
-    constexpr E unwrap_err() {
+    constexpr E unwrap_err() && {
         if (is_ok()) throw std::bad_variant_access();
-        return std::get<ErrT>(value).value;
+        return std::get<ErrT>(std::move(value)).value;
     }
 
-    constexpr E unwrap_err() const {
+    constexpr E unwrap_err() const& {
         if (is_ok()) throw std::bad_variant_access();
         return std::get<ErrT>(value).value;
     }
 
-    constexpr T unwrap_or_default() requires std::is_default_constructible_v<T> {
+    constexpr T unwrap_or_default() && requires std::is_default_constructible_v<T> {
         if (is_ok()) {
             return std::get<OkT>(std::move(value)).value;
         }
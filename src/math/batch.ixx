@@ -0,0 +1,408 @@
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// MSVC compiles intrinsics for any instruction set, so both SIMD paths are always built there and
+// picked at runtime. Other compilers only build the paths their target flags enable.
+#if defined(_MSC_VER) && defined(_M_X64)
+#define STELLAR_BATCH_SSE
+#define STELLAR_BATCH_AVX2
+#include <intrin.h>
+#else
+#if defined(__SSE4_2__)
+#define STELLAR_BATCH_SSE
+#endif
+#if defined(__AVX2__)
+#define STELLAR_BATCH_AVX2
+#endif
+#endif
+
+#if defined(STELLAR_BATCH_SSE) || defined(STELLAR_BATCH_AVX2)
+#include <immintrin.h>
+#endif
+
+export module stellar.math.batch;
+
+static_assert(sizeof(glm::quat) == 16 && offsetof(glm::quat, x) == 0 && offsetof(glm::quat, w) == 12, "batch kernels load quaternions as x, y, z, w");
+
+export enum class BatchIsa {
+    Scalar,
+    Sse42,
+    Avx2,
+};
+
+// The kernels below work on structure-of-arrays registers: lane l of every register belongs to the
+// same element. A lane type loads count consecutive floats from each of width elements, element j
+// starting at base + j * stride, into count registers, and stores them back the same way.
+struct ScalarLanes {
+    using V = float;
+    static constexpr size_t width = 1;
+
+    static void load(const float* base, size_t, const size_t count, V* out) {
+        for (size_t k = 0; k < count; k++) {
+            out[k] = base[k];
+        }
+    }
+
+    static void store(float* base, size_t, const size_t count, const V* in) {
+        for (size_t k = 0; k < count; k++) {
+            base[k] = in[k];
+        }
+    }
+};
+
+#ifdef STELLAR_BATCH_SSE
+struct Float4 {
+    __m128 v;
+
+    Float4() = default;
+    Float4(const __m128 v): v(v) {}
+    explicit Float4(const float f): v(_mm_set1_ps(f)) {}
+};
+
+inline Float4 operator+(const Float4 a, const Float4 b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(const Float4 a, const Float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(const Float4 a, const Float4 b) { return _mm_mul_ps(a.v, b.v); }
+
+// Four elements per register; groups of four floats are transposed in registers.
+struct SseLanes {
+    using V = Float4;
+    static constexpr size_t width = 4;
+
+    static void load(const float* base, const size_t stride, const size_t count, V* out) {
+        const size_t grouped = count - count % 4;
+        size_t k = 0;
+        for (; k < grouped; k += 4) {
+            __m128 r0 = _mm_loadu_ps(base + k);
+            __m128 r1 = _mm_loadu_ps(base + stride + k);
+            __m128 r2 = _mm_loadu_ps(base + 2 * stride + k);
+            __m128 r3 = _mm_loadu_ps(base + 3 * stride + k);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            out[k] = r0;
+            out[k + 1] = r1;
+            out[k + 2] = r2;
+            out[k + 3] = r3;
+        }
+        for (; k < count; k++) {
+            out[k] = _mm_setr_ps(base[k], base[stride + k], base[2 * stride + k], base[3 * stride + k]);
+        }
+    }
+
+    static void store(float* base, const size_t stride, const size_t count, const V* in) {
+        const size_t grouped = count - count % 4;
+        size_t k = 0;
+        for (; k < grouped; k += 4) {
+            __m128 r0 = in[k].v;
+            __m128 r1 = in[k + 1].v;
+            __m128 r2 = in[k + 2].v;
+            __m128 r3 = in[k + 3].v;
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(base + k, r0);
+            _mm_storeu_ps(base + stride + k, r1);
+            _mm_storeu_ps(base + 2 * stride + k, r2);
+            _mm_storeu_ps(base + 3 * stride + k, r3);
+        }
+        for (; k < count; k++) {
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, in[k].v);
+            for (size_t j = 0; j < 4; j++) {
+                base[j * stride + k] = lanes[j];
+            }
+        }
+    }
+};
+#endif
+
+#ifdef STELLAR_BATCH_AVX2
+struct Float8 {
+    __m256 v;
+
+    Float8() = default;
+    Float8(const __m256 v): v(v) {}
+    explicit Float8(const float f): v(_mm256_set1_ps(f)) {}
+};
+
+inline Float8 operator+(const Float8 a, const Float8 b) { return _mm256_add_ps(a.v, b.v); }
+inline Float8 operator-(const Float8 a, const Float8 b) { return _mm256_sub_ps(a.v, b.v); }
+inline Float8 operator*(const Float8 a, const Float8 b) { return _mm256_mul_ps(a.v, b.v); }
+
+// Eight elements per register. Transposes stay within the 128-bit halves, so the low half holds
+// the even elements and the high half the odd ones; lane l belongs to element LANE_ELEMENTS[l].
+struct Avx2Lanes {
+    using V = Float8;
+    static constexpr size_t width = 8;
+    static constexpr size_t LANE_ELEMENTS[8] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+
+    static void transpose(__m256& r0, __m256& r1, __m256& r2, __m256& r3) {
+        const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+        const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+        const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+        const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+        r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    }
+
+    static __m256 load_pair(const float* low, const float* high) {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+    }
+
+    static void load(const float* base, const size_t stride, const size_t count, V* out) {
+        const size_t grouped = count - count % 4;
+        size_t k = 0;
+        for (; k < grouped; k += 4) {
+            __m256 r0 = load_pair(base + k, base + stride + k);
+            __m256 r1 = load_pair(base + 2 * stride + k, base + 3 * stride + k);
+            __m256 r2 = load_pair(base + 4 * stride + k, base + 5 * stride + k);
+            __m256 r3 = load_pair(base + 6 * stride + k, base + 7 * stride + k);
+            transpose(r0, r1, r2, r3);
+            out[k] = r0;
+            out[k + 1] = r1;
+            out[k + 2] = r2;
+            out[k + 3] = r3;
+        }
+        for (; k < count; k++) {
+            alignas(32) float lanes[8];
+            for (size_t l = 0; l < 8; l++) {
+                lanes[l] = base[LANE_ELEMENTS[l] * stride + k];
+            }
+            out[k] = _mm256_load_ps(lanes);
+        }
+    }
+
+    static void store(float* base, const size_t stride, const size_t count, const V* in) {
+        const size_t grouped = count - count % 4;
+        size_t k = 0;
+        for (; k < grouped; k += 4) {
+            __m256 r[4] = { in[k].v, in[k + 1].v, in[k + 2].v, in[k + 3].v };
+            transpose(r[0], r[1], r[2], r[3]);
+            for (size_t i = 0; i < 4; i++) {
+                _mm_storeu_ps(base + 2 * i * stride + k, _mm256_castps256_ps128(r[i]));
+                _mm_storeu_ps(base + (2 * i + 1) * stride + k, _mm256_extractf128_ps(r[i], 1));
+            }
+        }
+        for (; k < count; k++) {
+            alignas(32) float lanes[8];
+            _mm256_store_ps(lanes, in[k].v);
+            for (size_t l = 0; l < 8; l++) {
+                base[LANE_ELEMENTS[l] * stride + k] = lanes[l];
+            }
+        }
+    }
+};
+#endif
+
+// Column-major rotation matrix of the quaternion (x, y, z, w), as glm::toMat3 builds it.
+template<typename V>
+void rotation_lanes(const V q[4], V m[9]) {
+    const V one(1.0f);
+    const V two(2.0f);
+    const V xx = q[0] * q[0];
+    const V yy = q[1] * q[1];
+    const V zz = q[2] * q[2];
+    const V xy = q[0] * q[1];
+    const V xz = q[0] * q[2];
+    const V yz = q[1] * q[2];
+    const V wx = q[3] * q[0];
+    const V wy = q[3] * q[1];
+    const V wz = q[3] * q[2];
+    m[0] = one - two * (yy + zz);
+    m[1] = two * (xy + wz);
+    m[2] = two * (xz - wy);
+    m[3] = two * (xy - wz);
+    m[4] = one - two * (xx + zz);
+    m[5] = two * (yz + wx);
+    m[6] = two * (xz + wy);
+    m[7] = two * (yz - wx);
+    m[8] = one - two * (xx + yy);
+}
+
+template<typename V>
+void multiply_affine_lanes(const V a[12], const V b[12], V out[12]) {
+    for (size_t c = 0; c < 4; c++) {
+        for (size_t r = 0; r < 3; r++) {
+            const V sum = a[r] * b[c * 3] + a[3 + r] * b[c * 3 + 1] + a[6 + r] * b[c * 3 + 2];
+            out[c * 3 + r] = c == 3 ? sum + a[9 + r] : sum;
+        }
+    }
+}
+
+template<typename V>
+void multiply_lanes(const V a[16], const V b[16], V out[16]) {
+    for (size_t c = 0; c < 4; c++) {
+        for (size_t r = 0; r < 4; r++) {
+            out[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2] + a[12 + r] * b[c * 4 + 3];
+        }
+    }
+}
+
+// Every kernel runs whole registers first and finishes the last count % width elements with the
+// scalar lanes. Inputs are fully loaded before a register is stored, so out may alias an input.
+template<typename L>
+void rotation_matrices_kernel(const glm::quat* rotations, glm::mat3* out, const size_t count) {
+    using V = typename L::V;
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        V q[4];
+        L::load(&rotations[i].x, 4, 4, q);
+        V m[9];
+        rotation_lanes(q, m);
+        L::store(&out[i][0].x, 9, 9, m);
+    }
+    if constexpr (L::width > 1) {
+        rotation_matrices_kernel<ScalarLanes>(rotations + i, out + i, count - i);
+    }
+}
+
+template<typename L>
+void compose_affine_kernel(const glm::vec3* translations, const glm::quat* rotations, const glm::vec3* scales, glm::mat4x3* out, const size_t count) {
+    using V = typename L::V;
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        V q[4];
+        L::load(&rotations[i].x, 4, 4, q);
+        V s[3];
+        L::load(&scales[i].x, 3, 3, s);
+        V m[12];
+        rotation_lanes(q, m);
+        for (size_t c = 0; c < 3; c++) {
+            for (size_t r = 0; r < 3; r++) {
+                m[c * 3 + r] = m[c * 3 + r] * s[c];
+            }
+        }
+        L::load(&translations[i].x, 3, 3, m + 9);
+        L::store(&out[i][0].x, 12, 12, m);
+    }
+    if constexpr (L::width > 1) {
+        compose_affine_kernel<ScalarLanes>(translations + i, rotations + i, scales + i, out + i, count - i);
+    }
+}
+
+template<typename L>
+void multiply_affine_kernel(const glm::mat4x3* a, const glm::mat4x3* b, glm::mat4x3* out, const size_t count) {
+    using V = typename L::V;
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        V lhs[12];
+        V rhs[12];
+        L::load(&a[i][0].x, 12, 12, lhs);
+        L::load(&b[i][0].x, 12, 12, rhs);
+        V m[12];
+        multiply_affine_lanes(lhs, rhs, m);
+        L::store(&out[i][0].x, 12, 12, m);
+    }
+    if constexpr (L::width > 1) {
+        multiply_affine_kernel<ScalarLanes>(a + i, b + i, out + i, count - i);
+    }
+}
+
+template<typename L>
+void multiply_kernel(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, const size_t count) {
+    using V = typename L::V;
+    size_t i = 0;
+    for (; i + L::width <= count; i += L::width) {
+        V lhs[16];
+        V rhs[16];
+        L::load(&a[i][0].x, 16, 16, lhs);
+        L::load(&b[i][0].x, 16, 16, rhs);
+        V m[16];
+        multiply_lanes(lhs, rhs, m);
+        L::store(&out[i][0].x, 16, 16, m);
+    }
+    if constexpr (L::width > 1) {
+        multiply_kernel<ScalarLanes>(a + i, b + i, out + i, count - i);
+    }
+}
+
+struct BatchKernels {
+    BatchIsa isa;
+    void (*rotation_matrices)(const glm::quat*, glm::mat3*, size_t);
+    void (*compose_affine)(const glm::vec3*, const glm::quat*, const glm::vec3*, glm::mat4x3*, size_t);
+    void (*multiply_affine)(const glm::mat4x3*, const glm::mat4x3*, glm::mat4x3*, size_t);
+    void (*multiply)(const glm::mat4*, const glm::mat4*, glm::mat4*, size_t);
+};
+
+template<typename L>
+constexpr BatchKernels make_batch_kernels(const BatchIsa isa) {
+    return BatchKernels {
+        .isa = isa,
+        .rotation_matrices = &rotation_matrices_kernel<L>,
+        .compose_affine = &compose_affine_kernel<L>,
+        .multiply_affine = &multiply_affine_kernel<L>,
+        .multiply = &multiply_kernel<L>
+    };
+}
+
+BatchIsa detect_batch_isa() {
+#if defined(_MSC_VER) && defined(_M_X64)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool sse42 = (info[2] & (1 << 20)) != 0;
+    // AVX registers are only usable when the OS saves them on context switches.
+    const bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    bool avx2 = false;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    if (avx2 && os_avx) return BatchIsa::Avx2;
+    if (sse42) return BatchIsa::Sse42;
+    return BatchIsa::Scalar;
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return BatchIsa::Avx2;
+    if (__builtin_cpu_supports("sse4.2")) return BatchIsa::Sse42;
+    return BatchIsa::Scalar;
+#else
+    return BatchIsa::Scalar;
+#endif
+}
+
+// The best kernels this build has for the running CPU, chosen on first use.
+const BatchKernels& batch_kernels() {
+    static const BatchKernels kernels = [] {
+        const BatchIsa isa = detect_batch_isa();
+#ifdef STELLAR_BATCH_AVX2
+        if (isa == BatchIsa::Avx2) return make_batch_kernels<Avx2Lanes>(BatchIsa::Avx2);
+#endif
+#ifdef STELLAR_BATCH_SSE
+        if (isa == BatchIsa::Avx2 || isa == BatchIsa::Sse42) return make_batch_kernels<SseLanes>(BatchIsa::Sse42);
+#endif
+        return make_batch_kernels<ScalarLanes>(BatchIsa::Scalar);
+    }();
+    return kernels;
+}
+
+export BatchIsa batch_isa() {
+    return batch_kernels().isa;
+}
+
+// out[i] = toMat3(rotations[i]), for unit quaternions.
+export void batch_rotation_matrices(const std::span<const glm::quat> rotations, const std::span<glm::mat3> out) {
+    batch_kernels().rotation_matrices(rotations.data(), out.data(), out.size());
+}
+
+// out[i] = translate(translations[i]) * toMat4(rotations[i]) * scale(scales[i]), as affine matrices.
+export void batch_compose_affine(const std::span<const glm::vec3> translations, const std::span<const glm::quat> rotations, const std::span<const glm::vec3> scales, const std::span<glm::mat4x3> out) {
+    batch_kernels().compose_affine(translations.data(), rotations.data(), scales.data(), out.data(), out.size());
+}
+
+// out[i] = a[i] * b[i] for affine matrices, skipping the implicit bottom row.
+export void batch_multiply_affine(const std::span<const glm::mat4x3> a, const std::span<const glm::mat4x3> b, const std::span<glm::mat4x3> out) {
+    batch_kernels().multiply_affine(a.data(), b.data(), out.data(), out.size());
+}
+
+// out[i] = a[i] * b[i].
+export void batch_multiply(const std::span<const glm::mat4> a, const std::span<const glm::mat4> b, const std::span<glm::mat4> out) {
+    batch_kernels().multiply(a.data(), b.data(), out.data(), out.size());
+}
@@ -2,6 +2,7 @@ module;
 
 #include <glm/vec4.hpp>
 #include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 #include <vector>
 #include <optional>
 
@@ -16,9 +17,22 @@ export struct Vertex {
     glm::vec4 weights;
 };
 
+// A morph target only stores the vertices it moves, with their position and normal deltas.
+export struct MorphTarget {
+    std::vector<uint32_t> vertices;
+    std::vector<glm::vec3> position_deltas;
+    std::vector<glm::vec3> normal_deltas;
+};
+
 export struct Mesh {
     std::vector<Vertex> vertices;
     std::optional<std::vector<uint32_t>> indices;
+    std::vector<MorphTarget> morph_targets{};
+};
+
+// Weight of each of the mesh's morph targets, set on the mesh instance and animated by clips.
+export struct MorphWeights {
+    std::vector<float> weights;
 };
 
 export Mesh cube(const float half_size) {
@@ -391,6 +391,20 @@ void CommandEncoder::transition_textures(const std::span<TextureBarrier>& transi
     vkCmdPipelineBarrier2(active, &dependency_info);
 }
 
+// Makes storage buffer writes of earlier commands visible to every later command.
+void CommandEncoder::memory_barrier() const {
+    VkMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
+
+    VkDependencyInfo dependency_info{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency_info.memoryBarrierCount = 1;
+    dependency_info.pMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(active, &dependency_info);
+}
+
 void CommandEncoder::copy_buffer_to_texture(const Buffer &buffer, const Texture &texture, const TextureUsage layout) const {
     VkBufferImageCopy copy_region{};
     copy_region.bufferOffset = 0;
@@ -405,6 +419,19 @@ void CommandEncoder::copy_buffer_to_texture(const Buffer &buffer, const Texture
     vkCmdCopyBufferToImage(active, buffer.buffer, texture.texture, map_texture_layout(layout), 1, &copy_region);
 }
 
+void CommandEncoder::copy_buffer(const Buffer& source, const Buffer& destination, const size_t size) const {
+    copy_buffer(source, 0, destination, 0, size);
+}
+
+void CommandEncoder::copy_buffer(const Buffer& source, const size_t source_offset, const Buffer& destination, const size_t destination_offset, const size_t size) const {
+    VkBufferCopy copy_region{};
+    copy_region.srcOffset = source_offset;
+    copy_region.dstOffset = destination_offset;
+    copy_region.size = size;
+
+    vkCmdCopyBuffer(active, source.buffer, destination.buffer, 1, &copy_region);
+}
+
 void CommandEncoder::bind_pipeline(const Pipeline& pipeline) const {
     vkCmdBindPipeline(active, pipeline.bind_point, pipeline.pipeline);
 }
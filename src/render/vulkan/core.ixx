@@ -260,7 +260,10 @@ struct CommandEncoder {
     Result<void, VkResult> begin_encoding();
     void begin_render_pass(const RenderPassDescriptor& descriptor) const;
     void transition_textures(const std::span<TextureBarrier>& barriers) const;
+    void memory_barrier() const;
     void copy_buffer_to_texture(const Buffer& buffer, const Texture& texture, TextureUsage layout) const;
+    void copy_buffer(const Buffer& source, const Buffer& destination, size_t size) const;
+    void copy_buffer(const Buffer& source, size_t source_offset, const Buffer& destination, size_t destination_offset, size_t size) const;
     void bind_pipeline(const Pipeline& pipeline) const;
     void bind_index_buffer(const Buffer& buffer) const;
     void set_push_constants(const std::span<uint32_t>& push_constants) const;
@@ -313,6 +316,8 @@ constexpr VkFormat map_texture_format(const TextureFormat format) {
     switch (format) {
     case TextureFormat::Rgba8Unorm:
         return VK_FORMAT_R8G8B8A8_UNORM;
+    case TextureFormat::Rgba32Float:
+        return VK_FORMAT_R32G32B32A32_SFLOAT;
     case TextureFormat::D32:
         return VK_FORMAT_D32_SFLOAT;
     default:
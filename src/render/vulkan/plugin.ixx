@@ -6,10 +6,22 @@ module;
 #include <optional>
 #include <fstream>
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat3x4.hpp>
+#include <glm/mat4x3.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/packing.hpp>
+#include <glm/gtx/quaternion.hpp>
 #include <iostream>
+#include <bit>
+#include <unordered_map>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <span>
+#include <memory>
+#include <new>
 
 #pragma warning(disable: 4267)
 
@@ -20,6 +32,8 @@ import stellar.render.types;
 import stellar.render.primitives;
 import stellar.window;
 import stellar.scene.transform;
+import stellar.math.batch;
+import stellar.animation;
 import stellar.core.result;
 
 std::string read_file(const std::string& filename);
@@ -82,8 +96,169 @@ export struct Joint {
     uint32_t buffer_offset;
 };
 
+// GPU copy of a PackedTrack. value_offset counts float4s from the start of the clip's values; cubic
+// tracks point at their first segment, four float4s per segment.
+struct GPUAnimationTrack {
+    uint32_t timestamp_offset;
+    uint32_t value_offset;
+    uint32_t key_count;
+    uint32_t interpolation;
+    float sample_rate;
+    uint32_t padding[3];
+};
+
+// Byte offsets of a clip's sections in the animation buffer. The clip's tracks are its rotation,
+// translation and scale tracks back to back.
+struct GPUAnimationClip {
+    uint32_t track_offset;
+    uint32_t timestamp_offset;
+    uint32_t value_offset;
+    uint32_t translation_tracks;
+    uint32_t scale_tracks;
+};
+
+// A parent below the skeleton's joint count is another joint; anything above indexes the root
+// matrices uploaded every frame for the skeleton.
+struct GPUSkeletonJoint {
+    glm::quat rotation;
+    glm::vec4 translation;
+    glm::vec4 scale;
+    uint32_t parent;
+    uint32_t depth;
+    uint32_t output;
+    uint32_t rotation_track;
+    uint32_t translation_track;
+    uint32_t scale_track;
+    uint32_t padding[2];
+    glm::mat4 inverse_bind;
+};
+
+// Set on skinned meshes whose AnimationPlayer has GPUAnimation. Offsets count records in the
+// skeleton, root and pose buffers.
+struct AnimatedSkeleton {
+    flecs::entity player;
+    flecs::entity bound_animation;
+    std::vector<flecs::entity> joints;
+    std::vector<flecs::entity> roots;
+    std::vector<GPUSkeletonJoint> records;
+    uint32_t skeleton_offset;
+    uint32_t root_offset;
+    uint32_t pose_offset;
+    uint32_t max_depth;
+};
+
+// Palettes are cached per clip frame at sample_rate. With prebake, every frame of a clip is baked the
+// first time the clip is seen; playback loops over all of them anyway. Otherwise frames are baked on
+// first use.
+export struct PoseCacheSettings {
+    float sample_rate = 30.0f;
+    bool prebake = true;
+};
+
+// Joint palettes of one clip on one skeleton, frame_count palettes of joint_count matrices starting at
+// palette_offset. Skinned meshes instancing the same Mesh are assumed to share a skeleton.
+struct PosePaletteTable {
+    flecs::entity clip;
+    flecs::entity skeleton;
+    uint32_t joint_count;
+    uint32_t frame_count;
+    uint32_t palette_offset;
+    std::vector<bool> baked;
+};
+
+// Palettes are stored relative to the player's root, in the layout prepare_skinned_meshes uses for
+// joint_buffer, and are uploaded behind the per-character joints.
+struct PoseCache {
+    std::vector<PosePaletteTable> tables;
+    std::vector<glm::mat4> palettes;
+    std::vector<std::pair<uint32_t, uint32_t>> dirty;
+    uint32_t uploaded_offset = std::numeric_limits<uint32_t>::max();
+};
+
+// Set on skinned meshes that draw from the pose cache. Skinning applies the player's world transform.
+struct CachedSkinnedMesh {
+    flecs::entity player;
+};
+
+// Frame on which the joint palette of a skinned mesh last changed. Skinning, and the animation pass
+// for GPU animated skeletons, only run for meshes whose palette changed this frame; the others keep
+// the joints and skinned vertices from the last frame they did.
+struct SkinnedPose {
+    uint64_t changed_frame;
+};
+
+// Set on Static entities once their transform is in static_transform_buffer.
+struct BakedTransform {};
+
+// Node of the flattened transform hierarchy, uploaded for GPU propagation.
+struct GPUHierarchyNode {
+    glm::vec3 translation;
+    uint32_t parent;
+    glm::quat rotation;
+    glm::vec3 scale;
+    float padding;
+};
+
+// Sparse morph targets of a mesh in morph_buffer: one record per vertex moved by any target, each
+// pointing at its run of per-target deltas.
+struct GPUMorphVertex {
+    uint32_t vertex;
+    uint32_t delta_offset;
+    uint32_t delta_count;
+    uint32_t padding;
+};
+
+struct GPUMorphDelta {
+    glm::vec3 position;
+    uint32_t target;
+    glm::vec3 normal;
+    float padding;
+};
+
+struct GPUMorphTargets {
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t target_count;
+};
+
+// A mesh instance with morph weights draws, and is skinned, from its own copy of the mesh's vertices
+// in morph_vertex_buffer. The morph pass rewrites the moved vertices of that copy on frames its
+// weights change.
+struct MorphedMesh {
+    uint32_t vertex_offset;
+    uint32_t weight_offset;
+    std::vector<float> applied_weights{};
+    uint64_t changed_frame = 0;
+};
+
+export struct VertexAnimationSettings {
+    float sample_rate = 30.0f;
+};
+
+// Must match VERTEX_ANIMATION_TEXTURE_WIDTH in mesh.hlsl.
+constexpr uint32_t VERTEX_ANIMATION_TEXTURE_WIDTH = 4096;
+
+// Skinned positions and normals of a mesh for every frame of clip, relative to the player, baked
+// into an Rgba32Float texture. Set on every skinned mesh that can switch to vertex animation.
+struct BakedVertexAnimation {
+    flecs::entity player;
+    flecs::entity clip;
+    uint32_t texture;
+    uint32_t vertex_count;
+    uint32_t frame_count;
+    float sample_rate;
+};
+
+// Decoders allocate pixels with ::operator new, so a texture can keep the decoder's own buffer.
+export struct PixelDeleter {
+    void operator()(uint8_t* pixels) const {
+        ::operator delete(pixels);
+    }
+};
+
+// Tightly packed RGBA8 pixels, width * height * 4 bytes.
 export struct CPUTexture {
-    std::vector<uint8_t> data;
+    std::unique_ptr<uint8_t[], PixelDeleter> data;
     uint32_t width;
     uint32_t height;
 };
@@ -111,6 +286,8 @@ struct DynamicUniformIndex {
 
 struct RenderContext {
     Extent3d extent{};
+    // Without a window there is no surface: frames are submitted but nothing is drawn or presented.
+    bool headless{};
     Instance instance{};
     Adapter adapter{};
     Device device{};
@@ -124,8 +301,13 @@ struct RenderContext {
     Pipeline mesh_pipeline{};
     Pipeline skinned_mesh_pipeline{};
     Pipeline skinning_pipeline{};
+    Pipeline animation_pipeline{};
     Pipeline shadow_pipeline{};
     Pipeline skinned_shadow_pipeline{};
+    Pipeline vertex_animation_pipeline{};
+    Pipeline vertex_animation_shadow_pipeline{};
+    Pipeline morph_pipeline{};
+    Pipeline propagation_pipeline{};
 
     Buffer vertex_buffer{};
     Buffer skinned_vertex_buffer{};
@@ -133,9 +315,18 @@ struct RenderContext {
     Buffer view_buffer{};
     Buffer material_buffer{};
     Buffer transform_buffer{};
+    Buffer static_transform_buffer{};
     Buffer light_buffer{};
     Buffer joint_buffer{};
     Buffer post_skinning_buffer{};
+    Buffer animation_buffer{};
+    Buffer skeleton_buffer{};
+    Buffer root_buffer{};
+    Buffer pose_buffer{};
+    Buffer morph_buffer{};
+    Buffer morph_vertex_buffer{};
+    Buffer morph_weight_buffer{};
+    Buffer hierarchy_buffer{};
     Texture depth_texture{};
     TextureView depth_texture_view{};
 
@@ -143,56 +334,164 @@ struct RenderContext {
     uint32_t view_buffer_index{};
     uint32_t material_buffer_index{};
     uint32_t transform_buffer_index{};
+    uint32_t static_transform_buffer_index{};
     uint32_t light_buffer_index{};
     uint32_t joint_buffer_index{};
     uint32_t post_skinning_buffer_index{};
+    uint32_t animation_buffer_index{};
+    uint32_t skeleton_buffer_index{};
+    uint32_t root_buffer_index{};
+    uint32_t pose_buffer_index{};
+    uint32_t morph_buffer_index{};
+    uint32_t morph_vertex_buffer_index{};
+    uint32_t morph_weight_buffer_index{};
+    uint32_t morph_delta_offset{};
+    uint32_t hierarchy_buffer_index{};
+    // Version of the transform hierarchy in hierarchy_buffer, and whether any local changed this frame.
+    uint64_t hierarchy_version{};
+    bool hierarchy_changed{};
+
+    std::vector<GPUTexture> vertex_animation_textures{};
+    // Static transforms baked so far. Those baked this frame wait in static_transform_staging until
+    // Begin Render records their copy to static_transform_upload_offset; when the buffer grew, the
+    // one it replaced is kept until then to copy the earlier transforms over.
+    uint32_t static_transform_count{};
+    size_t static_transform_upload_offset{};
+    Buffer static_transform_staging{};
+    Buffer retired_static_transform_buffer{};
 
     //TODO: Figure a better way to share this
     SurfaceTexture surface_texture{};
 };
 
 struct RenderRunner {
-    flecs::query<GPUMesh, DynamicUniformIndex<Material>, DynamicUniformIndex<GlobalTransform>> mesh_query;
+    flecs::query<GPUMesh, DynamicUniformIndex<Material>, DynamicUniformIndex<GlobalTransform>, const MorphedMesh*> mesh_query;
     flecs::query<GPUMesh, DynamicUniformIndex<Material>, DynamicUniformIndex<GlobalTransform>> skinned_mesh_query;
     flecs::query<GPULight, DynamicUniformIndex<Light>> light_query;
+    flecs::query<GPUMesh, DynamicUniformIndex<Material>, BakedVertexAnimation> vertex_animation_query;
 };
 
+// Baked Static entities read their transform from the static buffer. A table never mixes baked and
+// moving entities, so the buffer is picked once per table.
+uint32_t transform_buffer_index(const RenderContext& context, flecs::iter& it) {
+    return it.table().has<BakedTransform>() ? context.static_transform_buffer_index : context.transform_buffer_index;
+}
+
+uint32_t transform_buffer_index(const RenderContext& context, const flecs::entity entity) {
+    return entity.has<BakedTransform>() ? context.static_transform_buffer_index : context.transform_buffer_index;
+}
+
+bool gpu_propagation(const flecs::world& world) {
+    const TransformPropagationSettings* settings = world.get<TransformPropagationSettings>();
+    return settings != nullptr && settings->gpu;
+}
+
+// Composes every world matrix straight into transform_buffer, one hierarchy level per dispatch.
+void propagate_transforms_on_gpu(flecs::iter&, size_t, RenderContext& context, const TransformHierarchy& hierarchy) {
+    if (!context.hierarchy_changed) return;
+
+    context.encoder.bind_pipeline(context.propagation_pipeline);
+    for (uint32_t level = 0; level + 1 < hierarchy.level_offsets.size(); level++) {
+        const uint32_t level_count = hierarchy.level_offsets[level + 1] - hierarchy.level_offsets[level];
+        std::array push_constants {
+            context.hierarchy_buffer_index,
+            context.transform_buffer_index,
+            hierarchy.level_offsets[level],
+            level_count
+        };
+        context.encoder.set_push_constants(push_constants);
+        context.encoder.dispatch(std::ceil(static_cast<float>(level_count) / 64.0f), 1, 1);
+        context.encoder.memory_barrier();
+    }
+}
+
+// Records the copies queued by bake_static_transforms ahead of everything that reads the buffer.
+void upload_static_transforms(RenderContext& context) {
+    if (context.static_transform_staging.buffer == VK_NULL_HANDLE) return;
+
+    if (context.retired_static_transform_buffer.buffer != VK_NULL_HANDLE) {
+        context.encoder.copy_buffer(context.retired_static_transform_buffer, context.static_transform_buffer, context.static_transform_upload_offset);
+    }
+    context.encoder.copy_buffer(context.static_transform_staging, 0, context.static_transform_buffer, context.static_transform_upload_offset, context.static_transform_staging.size);
+    context.encoder.memory_barrier();
+}
+
+// The frame's commands have finished with the staging and retired buffers once its fence signals.
+void release_static_transform_upload(RenderContext& context) {
+    if (context.static_transform_staging.buffer == VK_NULL_HANDLE) return;
+
+    context.device.destroy_buffer(context.static_transform_staging);
+    context.static_transform_staging = Buffer{};
+    if (context.retired_static_transform_buffer.buffer != VK_NULL_HANDLE) {
+        context.device.destroy_buffer(context.retired_static_transform_buffer);
+        context.retired_static_transform_buffer = Buffer{};
+    }
+}
+
 void begin_render(RenderContext& context) {
-    context.surface_texture = context.surface.acquire_texture(context.swapchain_semaphore).unwrap();
+    if (!context.headless) {
+        context.surface_texture = context.surface.acquire_texture(context.swapchain_semaphore).unwrap();
+    }
     context.encoder.begin_encoding().unwrap();
+    upload_static_transforms(context);
 }
 
 void end_render(RenderContext& context) {
     auto command_buffer = context.encoder.end_encoding().unwrap();
 
+    std::array command_buffers { command_buffer };
+    if (context.headless) {
+        context.queue.submit(command_buffers, {}, {}, context.render_fence).unwrap();
+        context.device.wait_for_fence(context.render_fence).unwrap();
+        context.encoder.reset_all(command_buffers);
+        release_static_transform_upload(context);
+        return;
+    }
+
     std::array wait_semaphores { context.swapchain_semaphore };
     std::array signal_semaphores { context.render_semaphore };
-    std::array command_buffers { command_buffer };
     context.queue.submit(command_buffers, wait_semaphores, signal_semaphores, context.render_fence).unwrap();
 
     // TODO: Check for window closure
     auto _ = context.queue.present(context.surface, context.surface_texture, signal_semaphores);
     context.device.wait_for_fence(context.render_fence).unwrap();
     context.encoder.reset_all(command_buffers);
+    release_static_transform_upload(context);
 }
 
 void skin_meshes(flecs::iter& it) {
     if (!it.next()) return;
     auto context = it.field<RenderContext>(0);
+    const uint64_t frame = it.world().get_info()->frame_count_total;
 
     context->encoder.bind_pipeline(context->skinning_pipeline);
     do {
         auto mesh = it.field<GPUMesh>(1);
         auto skinned_mesh = it.field<DynamicUniformIndex<SkinnedMesh>>(2);
+        auto cached_mesh = it.field<const CachedSkinnedMesh>(3);
+        auto pose = it.field<const SkinnedPose>(4);
+        auto morphed = it.field<const MorphedMesh>(5);
 
         for (const auto i: it) {
+            if (it.is_set(4) && pose[i].changed_frame != frame) continue;
+            uint32_t model_transform_offset = std::numeric_limits<uint32_t>::max();
+            uint32_t model_transform_buffer = context->transform_buffer_index;
+            if (it.is_set(3)) {
+                model_transform_offset = cached_mesh[i].player.get<DynamicUniformIndex<GlobalTransform>>()->offset;
+                model_transform_buffer = transform_buffer_index(*context, cached_mesh[i].player);
+            }
+            // Morphed meshes are skinned from their morphed copy of the vertices.
+            const bool is_morphed = it.is_set(5);
             std::array push_constants {
                 mesh[i].vertex_count,
-                context->vertex_buffer_index,
-                mesh[i].vertex_offset,
+                is_morphed ? context->morph_vertex_buffer_index : context->vertex_buffer_index,
+                is_morphed ? morphed[i].vertex_offset : mesh[i].vertex_offset,
                 context->joint_buffer_index,
                 skinned_mesh[i].offset,
-                context->post_skinning_buffer_index
+                context->post_skinning_buffer_index,
+                model_transform_buffer,
+                model_transform_offset,
+                mesh[i].vertex_offset
             };
             context->encoder.set_push_constants(push_constants);
             context->encoder.dispatch(std::ceil(static_cast<float>(mesh[i].vertex_count) / 128.0f), 1, 1);
@@ -200,7 +499,85 @@ void skin_meshes(flecs::iter& it) {
     } while(it.next());
 }
 
+// Rebuilds the moved vertices of every mesh instance whose morph weights changed this frame; the
+// barrier publishes them to skin_meshes and the draws.
+void morph_meshes(flecs::iter& it) {
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    const uint64_t frame = it.world().get_info()->frame_count_total;
+
+    context->encoder.bind_pipeline(context->morph_pipeline);
+    do {
+        auto mesh = it.field<GPUMesh>(1);
+        auto targets = it.field<const GPUMorphTargets>(2);
+        auto morphed = it.field<const MorphedMesh>(3);
+
+        for (const auto i: it) {
+            if (morphed[i].changed_frame != frame) continue;
+            // Instances inherit the mesh and its targets from the mesh prefab, so those fields are shared.
+            const GPUMesh& instance_mesh = it.is_self(1) ? mesh[i] : mesh[0];
+            const GPUMorphTargets& instance_targets = it.is_self(2) ? targets[i] : targets[0];
+            std::array push_constants {
+                context->morph_buffer_index,
+                instance_targets.vertex_offset,
+                instance_targets.vertex_count,
+                context->morph_delta_offset,
+                context->vertex_buffer_index,
+                instance_mesh.vertex_offset,
+                context->morph_vertex_buffer_index,
+                morphed[i].vertex_offset,
+                context->morph_weight_buffer_index,
+                morphed[i].weight_offset
+            };
+            context->encoder.set_push_constants(push_constants);
+            context->encoder.dispatch(std::ceil(static_cast<float>(instance_targets.vertex_count) / 64.0f), 1, 1);
+        }
+    } while(it.next());
+    context->encoder.memory_barrier();
+}
+
+// Poses every GPU animated skeleton for this frame; the barrier publishes the joint matrices to skin_meshes.
+void animate_skeletons(flecs::iter& it) {
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    const uint64_t frame = it.world().get_info()->frame_count_total;
+
+    context->encoder.bind_pipeline(context->animation_pipeline);
+    do {
+        auto skeleton = it.field<AnimatedSkeleton>(1);
+        auto skinned_mesh = it.field<DynamicUniformIndex<SkinnedMesh>>(2);
+        auto pose = it.field<const SkinnedPose>(3);
+
+        for (const auto i: it) {
+            if (it.is_set(3) && pose[i].changed_frame != frame) continue;
+            const AnimationPlayer* player = skeleton[i].player.get<AnimationPlayer>();
+            const GPUAnimationClip* clip = skeleton[i].bound_animation.get<GPUAnimationClip>();
+            std::array push_constants {
+                context->animation_buffer_index,
+                clip->track_offset,
+                clip->timestamp_offset,
+                clip->value_offset,
+                std::bit_cast<uint32_t>(player->active_animation.seek_time),
+                context->skeleton_buffer_index,
+                static_cast<uint32_t>(skeleton[i].skeleton_offset * sizeof(GPUSkeletonJoint)),
+                static_cast<uint32_t>(skeleton[i].records.size()),
+                skeleton[i].max_depth,
+                context->root_buffer_index,
+                skeleton[i].root_offset,
+                context->pose_buffer_index,
+                skeleton[i].pose_offset,
+                context->joint_buffer_index,
+                skinned_mesh[i].offset
+            };
+            context->encoder.set_push_constants(push_constants);
+            context->encoder.dispatch(1, 1, 1);
+        }
+    } while(it.next());
+    context->encoder.memory_barrier();
+}
+
 void prepare_shadows(RenderContext& context, const RenderRunner& runner) {
+    if (context.headless) return;
     runner.light_query
         .run([&](flecs::iter& it) {
             while (it.next()) {
@@ -245,11 +622,12 @@ void prepare_shadows(RenderContext& context, const RenderRunner& runner) {
                             while (it.next()) {
                                 auto mesh = it.field<GPUMesh>(0);
                                 auto transform_index = it.field<DynamicUniformIndex<GlobalTransform>>(2);
+                                auto morphed = it.field<const MorphedMesh>(3);
                                 for (const auto i: it) {
                                     std::array push_constants {
-                                        context.vertex_buffer_index,
-                                        mesh[i].vertex_offset,
-                                        context.transform_buffer_index,
+                                        it.is_set(3) ? context.morph_vertex_buffer_index : context.vertex_buffer_index,
+                                        it.is_set(3) ? morphed[i].vertex_offset : mesh[i].vertex_offset,
+                                        transform_buffer_index(context, it),
                                         transform_index[i].offset,
                                         context.light_buffer_index,
                                         light_offset,
@@ -276,7 +654,7 @@ void prepare_shadows(RenderContext& context, const RenderRunner& runner) {
                                     std::array push_constants {
                                         context.post_skinning_buffer_index,
                                         mesh[i].vertex_offset,
-                                        context.transform_buffer_index,
+                                        transform_buffer_index(context, it),
                                         transform_index[i].offset,
                                         context.light_buffer_index,
                                         light_offset,
@@ -291,6 +669,38 @@ void prepare_shadows(RenderContext& context, const RenderRunner& runner) {
                             }
                         });
 
+                    runner.vertex_animation_query
+                        .run([&context, &light_offset](flecs::iter& it) {
+                            context.encoder.bind_pipeline(context.vertex_animation_shadow_pipeline);
+                            context.encoder.bind_index_buffer(context.index_buffer);
+
+                            while (it.next()) {
+                                auto mesh = it.field<GPUMesh>(0);
+                                auto animation = it.field<BakedVertexAnimation>(2);
+                                for (const auto i: it) {
+                                    const AnimationPlayer* player = animation[i].player.get<AnimationPlayer>();
+                                    std::array push_constants {
+                                        context.vertex_buffer_index,
+                                        mesh[i].vertex_offset,
+                                        transform_buffer_index(context, animation[i].player),
+                                        animation[i].player.get<DynamicUniformIndex<GlobalTransform>>()->offset,
+                                        context.light_buffer_index,
+                                        light_offset,
+                                        animation[i].texture,
+                                        animation[i].vertex_count,
+                                        animation[i].frame_count,
+                                        std::bit_cast<uint32_t>(player->active_animation.seek_time * animation[i].sample_rate)
+                                    };
+                                    context.encoder.set_push_constants(push_constants);
+                                    if (mesh[i].index_count.has_value()) {
+                                        context.encoder.draw_indexed(mesh[i].index_count.value(), 1, mesh[i].index_offset.value(), 0, 0);
+                                    } else {
+                                        context.encoder.draw(mesh[i].vertex_count, 1, 0, 0);
+                                    }
+                                }
+                            }
+                        });
+
                     context.encoder.end_render_pass();
 
                     {
@@ -316,6 +726,7 @@ void prepare_shadows(RenderContext& context, const RenderRunner& runner) {
 }
 
 void render_meshes(RenderContext& context, const RenderRunner& runner) {
+    if (context.headless) return;
     {
         std::array barriers {
             TextureBarrier {
@@ -374,14 +785,15 @@ void render_meshes(RenderContext& context, const RenderRunner& runner) {
                 auto mesh = it.field<GPUMesh>(0);
                 auto material_index = it.field<DynamicUniformIndex<Material>>(1);
                 auto transform_index = it.field<DynamicUniformIndex<GlobalTransform>>(2);
+                auto morphed = it.field<const MorphedMesh>(3);
                 for (const auto i: it) {
                     std::array push_constants {
-                        context.vertex_buffer_index,
-                        mesh[i].vertex_offset,
+                        it.is_set(3) ? context.morph_vertex_buffer_index : context.vertex_buffer_index,
+                        it.is_set(3) ? morphed[i].vertex_offset : mesh[i].vertex_offset,
                         context.view_buffer_index,
                         context.material_buffer_index,
                         material_index[i].offset,
-                        context.transform_buffer_index,
+                        transform_buffer_index(context, it),
                         transform_index[i].offset,
                         context.light_buffer_index,
                         static_cast<uint32_t>(context.light_buffer.size / sizeof(Light)),
@@ -412,7 +824,7 @@ void render_meshes(RenderContext& context, const RenderRunner& runner) {
                         context.view_buffer_index,
                         context.material_buffer_index,
                         material_index[i].offset,
-                        context.transform_buffer_index,
+                        transform_buffer_index(context, it),
                         transform_index[i].offset,
                         context.light_buffer_index,
                         static_cast<uint32_t>(context.light_buffer.size / sizeof(Light)),
@@ -427,6 +839,42 @@ void render_meshes(RenderContext& context, const RenderRunner& runner) {
             }
         });
 
+    runner.vertex_animation_query
+        .run([&](flecs::iter& it) {
+            context.encoder.bind_pipeline(context.vertex_animation_pipeline);
+            context.encoder.bind_index_buffer(context.index_buffer);
+
+            while (it.next()) {
+                auto mesh = it.field<GPUMesh>(0);
+                auto material_index = it.field<DynamicUniformIndex<Material>>(1);
+                auto animation = it.field<BakedVertexAnimation>(2);
+                for (const auto i: it) {
+                    const AnimationPlayer* player = animation[i].player.get<AnimationPlayer>();
+                    std::array push_constants {
+                        context.vertex_buffer_index,
+                        mesh[i].vertex_offset,
+                        context.view_buffer_index,
+                        context.material_buffer_index,
+                        material_index[i].offset,
+                        transform_buffer_index(context, animation[i].player),
+                        animation[i].player.get<DynamicUniformIndex<GlobalTransform>>()->offset,
+                        context.light_buffer_index,
+                        static_cast<uint32_t>(context.light_buffer.size / sizeof(Light)),
+                        animation[i].texture,
+                        animation[i].vertex_count,
+                        animation[i].frame_count,
+                        std::bit_cast<uint32_t>(player->active_animation.seek_time * animation[i].sample_rate)
+                    };
+                    context.encoder.set_push_constants(push_constants);
+                    if (mesh[i].index_count.has_value()) {
+                        context.encoder.draw_indexed(mesh[i].index_count.value(), 1, mesh[i].index_offset.value(), 0, 0);
+                    } else {
+                        context.encoder.draw(mesh[i].vertex_count, 1, 0, 0);
+                    }
+                }
+            }
+        });
+
     context.encoder.end_render_pass();
 
     {
@@ -502,6 +950,139 @@ void prepare_meshes(flecs::iter& it) {
     }
 }
 
+// Packs the sparse morph targets of every mesh into morph_buffer, vertex records first and their deltas after.
+void prepare_morph_targets(flecs::iter& it) {
+    std::vector<GPUMorphVertex> all_vertices{};
+    std::vector<GPUMorphDelta> all_deltas{};
+
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    do {
+        auto mesh = it.field<Mesh>(1);
+        for (const auto i: it) {
+            const std::vector<MorphTarget>& morph_targets = mesh[i].morph_targets;
+            if (morph_targets.empty()) continue;
+
+            std::vector<std::pair<uint32_t, GPUMorphDelta>> deltas;
+            for (uint32_t t = 0; t < morph_targets.size(); t++) {
+                const MorphTarget& target = morph_targets[t];
+                for (uint32_t k = 0; k < target.vertices.size(); k++) {
+                    deltas.emplace_back(target.vertices[k], GPUMorphDelta {
+                        .position = target.position_deltas[k],
+                        .target = t,
+                        .normal = target.normal_deltas[k]
+                    });
+                }
+            }
+            std::ranges::stable_sort(deltas, {}, [](const auto& delta) { return delta.first; });
+
+            const uint32_t vertex_offset = all_vertices.size();
+            for (size_t d = 0; d < deltas.size(); d++) {
+                if (d == 0 || deltas[d].first != deltas[d - 1].first) {
+                    all_vertices.push_back(GPUMorphVertex {
+                        .vertex = deltas[d].first,
+                        .delta_offset = static_cast<uint32_t>(all_deltas.size()),
+                        .delta_count = 0
+                    });
+                }
+                all_vertices.back().delta_count++;
+                all_deltas.push_back(deltas[d].second);
+            }
+            it.entity(i).set<GPUMorphTargets>({
+                .vertex_offset = vertex_offset,
+                .vertex_count = static_cast<uint32_t>(all_vertices.size() - vertex_offset),
+                .target_count = static_cast<uint32_t>(morph_targets.size())
+            });
+        }
+    } while (it.next());
+    if (all_vertices.empty()) return;
+
+    context->morph_delta_offset = all_vertices.size() * sizeof(GPUMorphVertex);
+    context->morph_buffer = context->device.create_buffer(BufferDescriptor {
+        .size = context->morph_delta_offset + all_deltas.size() * sizeof(GPUMorphDelta),
+        .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+    }).unwrap();
+    {
+        uint8_t* data = static_cast<uint8_t*>(context->device.map_buffer(context->morph_buffer));
+        memcpy(data, all_vertices.data(), all_vertices.size() * sizeof(GPUMorphVertex));
+        memcpy(data + context->morph_delta_offset, all_deltas.data(), all_deltas.size() * sizeof(GPUMorphDelta));
+        context->device.unmap_buffer(context->morph_buffer);
+    }
+    context->morph_buffer_index = context->device.add_binding(context->morph_buffer);
+}
+
+// Gives every mesh instance with morph weights its own copy of the mesh's vertices to morph into.
+void prepare_morphed_meshes(flecs::iter& it) {
+    std::vector<Vertex> all_vertices{};
+    uint32_t weight_count = 0;
+
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    do {
+        for (const auto i: it) {
+            const flecs::entity entity = it.entity(i);
+            const GPUMorphTargets* targets = entity.get<GPUMorphTargets>();
+            const Mesh* mesh = entity.get<Mesh>();
+            if (targets == nullptr || mesh == nullptr) continue;
+
+            entity.set<MorphedMesh>({
+                .vertex_offset = static_cast<uint32_t>(all_vertices.size()),
+                .weight_offset = weight_count
+            });
+            all_vertices.insert(all_vertices.end(), mesh->vertices.begin(), mesh->vertices.end());
+            weight_count += targets->target_count;
+        }
+    } while (it.next());
+    if (all_vertices.empty()) return;
+
+    context->morph_vertex_buffer = context->device.create_buffer(BufferDescriptor {
+        .size = all_vertices.size() * sizeof(Vertex),
+        .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+    }).unwrap();
+    {
+        void* data = context->device.map_buffer(context->morph_vertex_buffer);
+        memcpy(data, all_vertices.data(), all_vertices.size() * sizeof(Vertex));
+        context->device.unmap_buffer(context->morph_vertex_buffer);
+    }
+    context->morph_vertex_buffer_index = context->device.add_binding(context->morph_vertex_buffer);
+
+    context->morph_weight_buffer = context->device.create_buffer(BufferDescriptor {
+        .size = weight_count * sizeof(float),
+        .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+    }).unwrap();
+    context->morph_weight_buffer_index = context->device.add_binding(context->morph_weight_buffer);
+}
+
+// Uploads the weights of instances whose weights changed and marks them for the morph pass. A
+// skinned instance has to be skinned again from the new vertices.
+void prepare_morph_weights(flecs::iter& it) {
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    const uint64_t frame = it.world().get_info()->frame_count_total;
+    float* data = nullptr;
+    do {
+        auto weights = it.field<const MorphWeights>(1);
+        auto morphed = it.field<MorphedMesh>(2);
+        for (const auto i: it) {
+            if (morphed[i].applied_weights == weights[i].weights) continue;
+            if (data == nullptr) {
+                data = static_cast<float*>(context->device.map_buffer(context->morph_weight_buffer));
+            }
+            const GPUMorphTargets* targets = it.entity(i).get<GPUMorphTargets>();
+            const size_t count = std::min<size_t>(weights[i].weights.size(), targets->target_count);
+            memcpy(data + morphed[i].weight_offset, weights[i].weights.data(), count * sizeof(float));
+            morphed[i].applied_weights = weights[i].weights;
+            morphed[i].changed_frame = frame;
+            if (it.entity(i).has<SkinnedMesh>()) {
+                it.entity(i).set<SkinnedPose>({ frame });
+            }
+        }
+    } while (it.next());
+    if (data != nullptr) {
+        context->device.unmap_buffer(context->morph_weight_buffer);
+    }
+}
+
 void prepare_materials(flecs::iter& it) {
     std::vector<GPUMaterial> all_materials {};
 
@@ -538,70 +1119,655 @@ void prepare_materials(flecs::iter& it) {
     context->material_buffer_index = context->device.add_binding(context->material_buffer);
 }
 
+// Transforms are uploaded as the three rows of their affine matrix, 48 bytes each. Only moving
+// entities are uploaded every frame; Static ones are baked by bake_static_transforms. With GPU
+// propagation, upload_transform_hierarchy fills the buffer instead.
 void prepare_transforms(flecs::iter& it) {
-    std::vector<glm::mat4> all_transforms{};
+    std::vector<glm::mat3x4> all_transforms{};
+
+    if (gpu_propagation(it.world())) {
+        it.fini();
+        return;
+    }
+
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    do {
+        auto transform = it.field<GlobalTransform>(1);
+        for (const auto i: it) {
+            uint32_t index = all_transforms.size();
+            all_transforms.push_back(glm::transpose(transform[i].transform));
+            // The index only moves when entities are added or removed, so most frames set nothing.
+            const flecs::entity entity = it.entity(i);
+            const DynamicUniformIndex<GlobalTransform>* current = entity.get<DynamicUniformIndex<GlobalTransform>>();
+            if (current == nullptr || current->offset != index) {
+                entity.set<DynamicUniformIndex<GlobalTransform>>({ index });
+            }
+        }
+    } while (it.next());
+
+    if (all_transforms.empty()) return;
+
+    const size_t transform_buffer_size = all_transforms.size() * sizeof(glm::mat3x4);
+    if (context->transform_buffer.buffer == VK_NULL_HANDLE || context->transform_buffer.size < transform_buffer_size) {
+        if (context->transform_buffer.buffer != VK_NULL_HANDLE) {
+            context->device.destroy_buffer(context->transform_buffer);
+            context->device.buffer_heap.free(context->transform_buffer_index);
+        }
+        context->transform_buffer = context->device.create_buffer(BufferDescriptor {
+            .size = transform_buffer_size,
+            .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+        }).unwrap();
+        context->transform_buffer_index = context->device.add_binding(context->transform_buffer);
+    }
+    {
+        void* data = context->device.map_buffer(context->transform_buffer);
+        memcpy(data, all_transforms.data(), transform_buffer_size);
+        context->device.unmap_buffer(context->transform_buffer);
+    }
+}
+
+// Static transforms live in a device-local buffer that is only written when new Static entities
+// appear. Their transforms are staged here and copied at the start of the frame's commands; the
+// buffer grows geometrically so earlier transforms are rarely moved.
+void bake_static_transforms(flecs::iter& it) {
+    if (gpu_propagation(it.world())) {
+        it.fini();
+        return;
+    }
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    std::vector<glm::mat3x4> new_transforms{};
+    do {
+        auto transform = it.field<const GlobalTransform>(1);
+        for (const auto i: it) {
+            uint32_t index = context->static_transform_count + new_transforms.size();
+            new_transforms.push_back(glm::transpose(transform[i].transform));
+            it.entity(i)
+                .set<DynamicUniformIndex<GlobalTransform>>({ index })
+                .add<BakedTransform>();
+        }
+    } while (it.next());
+
+    if (new_transforms.empty()) return;
+
+    const size_t offset = context->static_transform_count * sizeof(glm::mat3x4);
+    const size_t size = new_transforms.size() * sizeof(glm::mat3x4);
+    context->static_transform_count += new_transforms.size();
+    context->static_transform_upload_offset = offset;
+    context->static_transform_staging = context->device.create_buffer(BufferDescriptor {
+        .size = size,
+        .usage = BufferUsage::MapReadWrite | BufferUsage::TransferSrc
+    }).unwrap();
+    {
+        void* data = context->device.map_buffer(context->static_transform_staging);
+        memcpy(data, new_transforms.data(), size);
+        context->device.unmap_buffer(context->static_transform_staging);
+    }
+
+    if (context->static_transform_buffer.buffer != VK_NULL_HANDLE && context->static_transform_buffer.size >= offset + size) return;
+
+    const size_t capacity = std::max<size_t>(offset + size, 2 * context->static_transform_buffer.size);
+    if (context->static_transform_buffer.buffer != VK_NULL_HANDLE) {
+        context->retired_static_transform_buffer = context->static_transform_buffer;
+        context->device.buffer_heap.free(context->static_transform_buffer_index);
+    }
+    context->static_transform_buffer = context->device.create_buffer(BufferDescriptor {
+        .size = capacity,
+        .usage = BufferUsage::Storage | BufferUsage::TransferSrc | BufferUsage::TransferDst
+    }).unwrap();
+    context->static_transform_buffer_index = context->device.add_binding(context->static_transform_buffer);
+}
+
+// Uploads the locals that changed since the last frame; the whole hierarchy, and the transform
+// indices of its entities, only when it was rebuilt. Transforms are indexed by hierarchy node.
+void upload_transform_hierarchy(flecs::iter&, size_t, RenderContext& context, TransformHierarchy& hierarchy, const TransformPropagationSettings& settings) {
+    context.hierarchy_changed = false;
+    const uint32_t count = hierarchy.parents.size();
+    if (!settings.gpu || count == 0) return;
+
+    if (context.hierarchy_version != hierarchy.version) {
+        const size_t transform_buffer_size = count * sizeof(glm::mat3x4);
+        if (context.transform_buffer.buffer == VK_NULL_HANDLE || context.transform_buffer.size < transform_buffer_size) {
+            if (context.transform_buffer.buffer != VK_NULL_HANDLE) {
+                context.device.destroy_buffer(context.transform_buffer);
+                context.device.buffer_heap.free(context.transform_buffer_index);
+            }
+            context.transform_buffer = context.device.create_buffer(BufferDescriptor {
+                .size = transform_buffer_size,
+                .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+            }).unwrap();
+            context.transform_buffer_index = context.device.add_binding(context.transform_buffer);
+        }
+
+        const size_t hierarchy_buffer_size = count * sizeof(GPUHierarchyNode);
+        if (context.hierarchy_buffer.buffer == VK_NULL_HANDLE || context.hierarchy_buffer.size < hierarchy_buffer_size) {
+            if (context.hierarchy_buffer.buffer != VK_NULL_HANDLE) {
+                context.device.destroy_buffer(context.hierarchy_buffer);
+                context.device.buffer_heap.free(context.hierarchy_buffer_index);
+            }
+            context.hierarchy_buffer = context.device.create_buffer(BufferDescriptor {
+                .size = hierarchy_buffer_size,
+                .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+            }).unwrap();
+            context.hierarchy_buffer_index = context.device.add_binding(context.hierarchy_buffer);
+        }
+
+        hierarchy.node_query.each([](const flecs::entity entity, const HierarchyNode& node, GlobalTransform&) {
+            entity.set<DynamicUniformIndex<GlobalTransform>>({ node.index });
+        });
+        context.hierarchy_version = hierarchy.version;
+    }
+
+    auto* nodes = static_cast<GPUHierarchyNode*>(context.device.map_buffer(context.hierarchy_buffer));
+    for (uint32_t i = 0; i < count; i++) {
+        if (!hierarchy.changed[i]) continue;
+        nodes[i] = GPUHierarchyNode {
+            .translation = hierarchy.translations[i],
+            .parent = hierarchy.parents[i],
+            .rotation = hierarchy.rotations[i],
+            .scale = hierarchy.scales[i]
+        };
+        hierarchy.changed[i] = 0;
+        context.hierarchy_changed = true;
+    }
+    context.device.unmap_buffer(context.hierarchy_buffer);
+}
+
+flecs::entity find_animation_player(flecs::entity entity) {
+    while (entity.is_valid() && !entity.has<AnimationPlayer>()) {
+        entity = entity.parent();
+    }
+    return entity;
+}
+
+flecs::entity find_cached_pose_player(const flecs::entity mesh, const std::vector<flecs::entity>& joints) {
+    if (joints.empty() || mesh.has<AnimatedSkeleton>()) return flecs::entity::null();
+    if (const CachedSkinnedMesh* cached = mesh.get<CachedSkinnedMesh>(); cached != nullptr && cached->player.has<CachedPose>()) {
+        return cached->player;
+    }
+    const flecs::entity player = find_animation_player(joints[0]);
+    return player.is_valid() && player.has<CachedPose>() ? player : flecs::entity::null();
+}
+
+// Samples the clip at seek_time and composes the player's hierarchy relative to the player, with
+// nodes the clip does not animate at their AnimationTarget rest pose, so the palette depends only on
+// the clip and the time and can be shared by every player of the clip. Writes one matrix per joint,
+// in the joint_buffer layout.
+void compose_pose_palette(
+    const flecs::entity player_entity,
+    const PackedAnimationClip& clip,
+    const std::vector<flecs::entity>& joints,
+    const float seek_time,
+    KeyframeCursors& cursors,
+    AnimationPose& pose,
+    glm::mat4* palette
+) {
+    const AnimationPlayer* player = player_entity.get<AnimationPlayer>();
+    sample_clip(clip, std::min(seek_time, clip.duration), cursors, pose);
+
+    std::unordered_map<flecs::entity_t, glm::mat4> globals;
+    globals.reserve(player->bindings.size());
+    for (const AnimationBinding& binding: player->bindings) {
+        if (binding.target == player_entity) {
+            globals.emplace(binding.target.id(), glm::mat4(1.0f));
+            continue;
+        }
+
+        Transform local = binding.rest;
+        if (const JointTracks* tracks = clip.find_joint_tracks(binding.tracks.joint_index)) {
+            if (tracks->rotation != NO_TRACK) {
+                local.rotation = pose.rotations[tracks->rotation];
+            }
+            if (tracks->translation != NO_TRACK) {
+                local.translation = pose.translations[tracks->translation];
+            }
+            if (tracks->scale != NO_TRACK) {
+                local.scale = pose.scales[tracks->scale];
+            }
+        }
+        const glm::mat4 local_mat = glm::translate(glm::mat4(1.0f), local.translation) * glm::toMat4(local.rotation) * glm::scale(glm::mat4(1.0f), local.scale);
+        const auto parent = globals.find(binding.target.parent().id());
+        globals.emplace(binding.target.id(), parent != globals.end() ? parent->second * local_mat : local_mat);
+    }
+
+    for (const flecs::entity joint_entity: joints) {
+        const Joint* joint = joint_entity.get<Joint>();
+        const auto global = globals.find(joint_entity.id());
+        palette[joint->buffer_offset] = (global != globals.end() ? global->second : glm::mat4(1.0f)) * joint->inverse_bind;
+    }
+}
+
+void bake_pose_palette(
+    PoseCache& cache,
+    PosePaletteTable& table,
+    const flecs::entity player_entity,
+    const std::vector<flecs::entity>& joints,
+    const uint32_t frame,
+    const float sample_rate,
+    KeyframeCursors& cursors,
+    AnimationPose& pose
+) {
+    const uint32_t palette_offset = table.palette_offset + frame * table.joint_count;
+    compose_pose_palette(player_entity, *table.clip.get<PackedAnimationClip>(), joints, frame / sample_rate, cursors, pose, cache.palettes.data() + palette_offset);
+    table.baked[frame] = true;
+    cache.dirty.emplace_back(palette_offset, table.joint_count);
+}
+
+// Returns the cache index of the palette for the player's clip at its quantized seek time, baking it
+// if no character has shown that frame yet.
+uint32_t find_pose_palette(PoseCache& cache, const PoseCacheSettings& settings, const flecs::entity mesh, const flecs::entity player_entity, const std::vector<flecs::entity>& joints) {
+    const AnimationPlayer* player = player_entity.get<AnimationPlayer>();
+    flecs::entity skeleton = mesh.target(flecs::IsA);
+    if (!skeleton.is_valid()) {
+        skeleton = mesh;
+    }
+
+    auto table = std::ranges::find_if(cache.tables, [&](const PosePaletteTable& t) { return t.clip == player->animation && t.skeleton == skeleton; });
+    if (table == cache.tables.end()) {
+        const PackedAnimationClip* clip = player->animation.get<PackedAnimationClip>();
+        table = cache.tables.insert(cache.tables.end(), PosePaletteTable {
+            .clip = player->animation,
+            .skeleton = skeleton,
+            .joint_count = static_cast<uint32_t>(joints.size()),
+            .frame_count = static_cast<uint32_t>(std::ceil(clip->duration * settings.sample_rate)) + 1,
+            .palette_offset = static_cast<uint32_t>(cache.palettes.size())
+        });
+        table->baked.resize(table->frame_count, false);
+        cache.palettes.resize(cache.palettes.size() + table->frame_count * table->joint_count);
+
+        if (settings.prebake) {
+            KeyframeCursors cursors{};
+            AnimationPose pose{};
+            for (uint32_t frame = 0; frame < table->frame_count; frame++) {
+                bake_pose_palette(cache, *table, player_entity, joints, frame, settings.sample_rate, cursors, pose);
+            }
+        }
+    }
+
+    const uint32_t frame = std::min(static_cast<uint32_t>(player->active_animation.seek_time * settings.sample_rate + 0.5f), table->frame_count - 1);
+    if (!table->baked[frame]) {
+        KeyframeCursors cursors{};
+        AnimationPose pose{};
+        bake_pose_palette(cache, *table, player_entity, joints, frame, settings.sample_rate, cursors, pose);
+    }
+    return table->palette_offset + frame * table->joint_count;
+}
+
+bool transform_changed(const flecs::entity entity, const uint64_t frame) {
+    if (!entity.is_valid()) return false;
+    const GlobalTransform* transform = entity.get<GlobalTransform>();
+    return transform == nullptr || transform->changed_frame == frame;
+}
+
+bool any_transform_changed(const std::vector<flecs::entity>& entities, const uint64_t frame) {
+    return std::ranges::any_of(entities, [&](const flecs::entity entity) { return transform_changed(entity, frame); });
+}
+
+// The operands are gathered in buffer_offset order, so one batch product writes the palette straight
+// into all_joints. globals and inverse_binds are scratch space reused across meshes.
+void write_joint_palette(std::vector<glm::mat4>& all_joints, const uint32_t initial_joint, const std::vector<flecs::entity>& mesh_joints, std::vector<glm::mat4>& globals, std::vector<glm::mat4>& inverse_binds) {
+    globals.resize(mesh_joints.size());
+    inverse_binds.resize(mesh_joints.size());
+    for (uint32_t j = 0; j < mesh_joints.size(); j++) {
+        const Joint* joint = mesh_joints[j].get<Joint>();
+        const GlobalTransform* transform = mesh_joints[j].get<GlobalTransform>();
+        globals[joint->buffer_offset] = glm::mat4(transform->transform);
+        inverse_binds[joint->buffer_offset] = joint->inverse_bind;
+    }
+    batch_multiply(globals, inverse_binds, std::span(all_joints).subspan(initial_joint, mesh_joints.size()));
+}
+
+// Only palettes whose joints moved this frame are rebuilt and uploaded; meshes whose joints kept
+// their place in joint_buffer and did not move are left alone, along with their skinned vertices.
+void prepare_skinned_meshes(flecs::iter& it) {
+    std::vector<glm::mat4> all_joints;
+    std::vector<std::pair<uint32_t, uint32_t>> cpu_joints;
+    std::vector<std::tuple<flecs::entity, uint32_t, flecs::entity>> cached_meshes;
+    std::vector<std::pair<flecs::entity, uint32_t>> idle_meshes;
+    std::vector<glm::mat4> palette_globals;
+    std::vector<glm::mat4> palette_inverse_binds;
+
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    auto cache = it.field<PoseCache>(1);
+    auto settings = it.field<const PoseCacheSettings>(2);
+    const uint64_t frame = it.world().get_info()->frame_count_total;
+    do {
+        auto mesh = it.field<SkinnedMesh>(3);
+        for (const auto i: it) {
+            const flecs::entity entity = it.entity(i);
+            const std::vector<flecs::entity>& mesh_joints = mesh[i].joints;
+            // Meshes on vertex animation are not skinned this frame, and are skinned again as soon as they leave it.
+            // They keep their joint slots, so the palettes of the meshes after them and the pose cache stay in place.
+            if (entity.has<VertexAnimationActive>()) {
+                if (entity.has<SkinnedPose>()) {
+                    entity.remove<SkinnedPose>();
+                }
+                if (!entity.has<CachedSkinnedMesh>()) {
+                    all_joints.resize(all_joints.size() + mesh_joints.size());
+                }
+                continue;
+            }
+            if (const flecs::entity player = find_cached_pose_player(entity, mesh_joints); player.is_valid()) {
+                if (!entity.has<CachedSkinnedMesh>()) {
+                    entity.set<CachedSkinnedMesh>({ player });
+                }
+                cached_meshes.emplace_back(entity, find_pose_palette(*cache, *settings, entity, player, mesh_joints), player);
+                continue;
+            }
+            if (entity.has<CachedSkinnedMesh>()) {
+                entity.remove<CachedSkinnedMesh>();
+            }
+
+            uint32_t initial_joint = all_joints.size();
+            all_joints.resize(all_joints.size() + mesh_joints.size());
+            const DynamicUniformIndex<SkinnedMesh>* index = entity.get<DynamicUniformIndex<SkinnedMesh>>();
+            const bool moved = index == nullptr || index->offset != initial_joint || !entity.has<SkinnedPose>();
+            if (moved) {
+                entity.set<DynamicUniformIndex<SkinnedMesh>>({ initial_joint });
+            }
+
+            // The animation compute pass writes the joints of animated skeletons, while playing or when their roots move.
+            if (const AnimatedSkeleton* skeleton = entity.get<AnimatedSkeleton>()) {
+                if (moved || skeleton->player.get<AnimationPlayer>()->active_animation.playing || any_transform_changed(skeleton->roots, frame)) {
+                    entity.set<SkinnedPose>({ frame });
+                } else {
+                    idle_meshes.emplace_back(entity, initial_joint);
+                }
+                continue;
+            }
+
+            if (!moved && !any_transform_changed(mesh_joints, frame)) {
+                idle_meshes.emplace_back(entity, initial_joint);
+                continue;
+            }
+            write_joint_palette(all_joints, initial_joint, mesh_joints, palette_globals, palette_inverse_binds);
+            cpu_joints.emplace_back(initial_joint, static_cast<uint32_t>(mesh_joints.size()));
+            entity.set<SkinnedPose>({ frame });
+        }
+    } while (it.next());
+
+    // The pose cache lives right behind the per-character joints. A cached palette only changes when
+    // the mesh moves to another frame or its player moves.
+    const uint32_t cache_offset = all_joints.size();
+    for (const auto& [entity, palette, player]: cached_meshes) {
+        const DynamicUniformIndex<SkinnedMesh>* index = entity.get<DynamicUniformIndex<SkinnedMesh>>();
+        if (index != nullptr && index->offset == cache_offset + palette && entity.has<SkinnedPose>() && !transform_changed(player, frame)) continue;
+        entity.set<DynamicUniformIndex<SkinnedMesh>>({ cache_offset + palette });
+        entity.set<SkinnedPose>({ frame });
+    }
+
+    const size_t joint_buffer_size = (all_joints.size() + cache->palettes.size()) * sizeof(glm::mat4);
+    if (context->joint_buffer.buffer == VK_NULL_HANDLE || context->joint_buffer.size < joint_buffer_size) {
+        if (context->joint_buffer.buffer != VK_NULL_HANDLE) {
+            context->device.destroy_buffer(context->joint_buffer);
+            context->device.buffer_heap.free(context->joint_buffer_index);
+        }
+        context->joint_buffer = context->device.create_buffer(BufferDescriptor {
+            .size = joint_buffer_size,
+            .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+        }).unwrap();
+        context->joint_buffer_index = context->device.add_binding(context->joint_buffer);
+        cache->uploaded_offset = std::numeric_limits<uint32_t>::max();
+
+        // Idle meshes left their joints in the old buffer.
+        for (const auto& [entity, offset]: idle_meshes) {
+            if (entity.has<AnimatedSkeleton>()) {
+                entity.set<SkinnedPose>({ frame });
+                continue;
+            }
+            const std::vector<flecs::entity>& mesh_joints = entity.get<SkinnedMesh>()->joints;
+            write_joint_palette(all_joints, offset, mesh_joints, palette_globals, palette_inverse_binds);
+            cpu_joints.emplace_back(offset, static_cast<uint32_t>(mesh_joints.size()));
+        }
+    }
+    if (cpu_joints.empty() && cache->uploaded_offset == cache_offset && cache->dirty.empty()) return;
+    {
+        glm::mat4* data = static_cast<glm::mat4*>(context->device.map_buffer(context->joint_buffer));
+        for (const auto& [offset, count]: cpu_joints) {
+            memcpy(data + offset, all_joints.data() + offset, count * sizeof(glm::mat4));
+        }
+        if (cache->uploaded_offset != cache_offset) {
+            memcpy(data + cache_offset, cache->palettes.data(), cache->palettes.size() * sizeof(glm::mat4));
+            cache->uploaded_offset = cache_offset;
+        } else {
+            for (const auto& [offset, count]: cache->dirty) {
+                memcpy(data + cache_offset + offset, cache->palettes.data() + offset, count * sizeof(glm::mat4));
+            }
+        }
+        cache->dirty.clear();
+        context->device.unmap_buffer(context->joint_buffer);
+    }
+}
+
+glm::vec4 gpu_animation_value(const QuantizedQuat key) {
+    const glm::quat rotation = dequantize_rotation(key);
+    return glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+}
+
+glm::vec4 gpu_animation_value(const glm::quat& rotation) {
+    return glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+}
+
+glm::vec4 gpu_animation_value(const glm::vec3& value) {
+    return glm::vec4(value, 0.0f);
+}
+
+template<typename T, typename Key>
+void pack_gpu_channel(const PackedChannel<T, Key>& channel, std::vector<GPUAnimationTrack>& tracks, std::vector<glm::vec4>& values) {
+    const uint32_t value_base = values.size();
+    for (const Key& value: channel.values) {
+        values.push_back(gpu_animation_value(value));
+    }
+    const uint32_t coefficient_base = values.size();
+    for (const T& coefficient: channel.coefficients) {
+        values.push_back(gpu_animation_value(coefficient));
+    }
+
+    for (const PackedTrack& track: channel.tracks) {
+        tracks.push_back(GPUAnimationTrack {
+            .timestamp_offset = track.timestamp_offset,
+            .value_offset = track.interpolation == Interpolation::CubicSpline ? coefficient_base + 4 * track.value_offset : value_base + track.value_offset,
+            .key_count = track.key_count,
+            .interpolation = static_cast<uint32_t>(track.interpolation),
+            .sample_rate = track.sample_rate
+        });
+    }
+}
+
+// Appends items to the animation buffer contents, padded so every section starts 16 byte aligned.
+template<typename T>
+uint32_t append_animation_data(std::vector<uint8_t>& data, const std::vector<T>& items) {
+    const uint32_t offset = data.size();
+    data.resize(offset + (items.size() * sizeof(T) + 15) / 16 * 16);
+    if (!items.empty()) {
+        memcpy(data.data() + offset, items.data(), items.size() * sizeof(T));
+    }
+    return offset;
+}
+
+void prepare_animations(flecs::iter& it) {
+    std::vector<uint8_t> all_data;
+
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    do {
+        auto clip = it.field<PackedAnimationClip>(1);
+        for (const auto i: it) {
+            std::vector<GPUAnimationTrack> tracks;
+            std::vector<glm::vec4> values;
+            pack_gpu_channel(clip[i].rotations, tracks, values);
+            const uint32_t translation_tracks = tracks.size();
+            pack_gpu_channel(clip[i].translations, tracks, values);
+            const uint32_t scale_tracks = tracks.size();
+            pack_gpu_channel(clip[i].scales, tracks, values);
+
+            it.entity(i).set<GPUAnimationClip>(GPUAnimationClip {
+                .track_offset = append_animation_data(all_data, tracks),
+                .timestamp_offset = append_animation_data(all_data, clip[i].timestamps),
+                .value_offset = append_animation_data(all_data, values),
+                .translation_tracks = translation_tracks,
+                .scale_tracks = scale_tracks
+            });
+        }
+    } while (it.next());
+
+    if (all_data.empty()) return;
+    context->animation_buffer = context->device.create_buffer(BufferDescriptor {
+        .size = all_data.size(),
+        .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+    }).unwrap();
+    {
+        void* data = context->device.map_buffer(context->animation_buffer);
+        memcpy(data, all_data.data(), all_data.size());
+        context->device.unmap_buffer(context->animation_buffer);
+    }
+    context->animation_buffer_index = context->device.add_binding(context->animation_buffer);
+}
+
+// Builds the joint records of every skinned mesh driven by a GPUAnimation player. Joints keep their
+// current Transform as the rest pose for nodes the clip does not animate.
+void prepare_skeletons(flecs::iter& it) {
+    uint32_t joint_count = 0;
+    uint32_t root_count = 0;
+
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    do {
+        auto mesh = it.field<SkinnedMesh>(1);
+        for (const auto i: it) {
+            const std::vector<flecs::entity>& joints = mesh[i].joints;
+            if (joints.empty()) continue;
+            const flecs::entity player = find_animation_player(joints[0]);
+            if (!player.is_valid() || !player.has<GPUAnimation>()) continue;
+
+            AnimatedSkeleton skeleton {
+                .player = player,
+                .joints = joints,
+                .skeleton_offset = joint_count,
+                .root_offset = root_count,
+                .pose_offset = joint_count,
+                .max_depth = 0
+            };
+            std::unordered_map<flecs::entity_t, uint32_t> joint_indices;
+            for (uint32_t j = 0; j < joints.size(); j++) {
+                joint_indices.emplace(joints[j].id(), j);
+            }
+
+            skeleton.records.resize(joints.size());
+            for (uint32_t j = 0; j < joints.size(); j++) {
+                const Transform transform = local_transform(joints[j]);
+                const Joint* joint = joints[j].get<Joint>();
+                GPUSkeletonJoint& record = skeleton.records[j];
+                record.rotation = transform.rotation;
+                record.translation = glm::vec4(transform.translation, 0.0f);
+                record.scale = glm::vec4(transform.scale, 0.0f);
+                record.output = joint->buffer_offset;
+                record.inverse_bind = joint->inverse_bind;
+                record.rotation_track = NO_TRACK;
+                record.translation_track = NO_TRACK;
+                record.scale_track = NO_TRACK;
+
+                const flecs::entity parent = joints[j].parent();
+                if (const auto parent_index = joint_indices.find(parent.id()); parent_index != joint_indices.end()) {
+                    record.parent = parent_index->second;
+                } else {
+                    auto root = std::ranges::find(skeleton.roots, parent);
+                    if (root == skeleton.roots.end()) {
+                        root = skeleton.roots.insert(root, parent);
+                    }
+                    record.parent = joints.size() + std::distance(skeleton.roots.begin(), root);
+                }
+            }
+            for (GPUSkeletonJoint& record: skeleton.records) {
+                record.depth = 0;
+                for (uint32_t parent = record.parent; parent < joints.size(); parent = skeleton.records[parent].parent) {
+                    record.depth++;
+                }
+                skeleton.max_depth = std::max(skeleton.max_depth, record.depth);
+            }
 
-    if (!it.next()) return;
-    auto context = it.field<RenderContext>(0);
-    do {
-        auto transform = it.field<GlobalTransform>(1);
-        for (const auto i: it) {
-            uint32_t index = all_transforms.size();
-            all_transforms.push_back(transform[i].transform);
-            it.entity(i).set<DynamicUniformIndex<GlobalTransform>>({ index });
+            joint_count += joints.size();
+            root_count += skeleton.roots.size();
+            it.entity(i).set<AnimatedSkeleton>(std::move(skeleton));
         }
     } while (it.next());
 
-    if (context->transform_buffer.buffer == VK_NULL_HANDLE) {
-        context->transform_buffer = context->device.create_buffer(BufferDescriptor {
-            .size = all_transforms.size() * sizeof(GlobalTransform),
-            .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
-        }).unwrap();
-        context->transform_buffer_index = context->device.add_binding(context->transform_buffer);
-    }
-    {
-        void* data = context->device.map_buffer(context->transform_buffer);
-        memcpy(data, all_transforms.data(), all_transforms.size() * sizeof(glm::mat4));
-        context->device.unmap_buffer(context->transform_buffer);
+    if (joint_count == 0) return;
+    context->skeleton_buffer = context->device.create_buffer(BufferDescriptor {
+        .size = joint_count * sizeof(GPUSkeletonJoint),
+        .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+    }).unwrap();
+    context->skeleton_buffer_index = context->device.add_binding(context->skeleton_buffer);
+
+    context->root_buffer = context->device.create_buffer(BufferDescriptor {
+        .size = root_count * sizeof(glm::mat4),
+        .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
+    }).unwrap();
+    context->root_buffer_index = context->device.add_binding(context->root_buffer);
+
+    context->pose_buffer = context->device.create_buffer(BufferDescriptor {
+        .size = joint_count * sizeof(glm::mat4),
+        .usage = BufferUsage::Storage
+    }).unwrap();
+    context->pose_buffer_index = context->device.add_binding(context->pose_buffer);
+}
+
+void bind_skeleton_tracks(AnimatedSkeleton& skeleton, const flecs::entity animation) {
+    const PackedAnimationClip* clip = animation.get<PackedAnimationClip>();
+    const GPUAnimationClip* gpu_clip = animation.get<GPUAnimationClip>();
+    for (uint32_t j = 0; j < skeleton.joints.size(); j++) {
+        GPUSkeletonJoint& record = skeleton.records[j];
+        const JointTracks* tracks = clip->find_joint_tracks(skeleton.joints[j].get<AnimationTarget>()->joint_index);
+        if (tracks == nullptr) {
+            record.rotation_track = NO_TRACK;
+            record.translation_track = NO_TRACK;
+            record.scale_track = NO_TRACK;
+            continue;
+        }
+        record.rotation_track = tracks->rotation;
+        record.translation_track = tracks->translation != NO_TRACK ? gpu_clip->translation_tracks + tracks->translation : NO_TRACK;
+        record.scale_track = tracks->scale != NO_TRACK ? gpu_clip->scale_tracks + tracks->scale : NO_TRACK;
     }
+    skeleton.bound_animation = animation;
 }
 
-void prepare_skinned_meshes(flecs::iter& it) {
-    std::vector<glm::mat4> all_joints;
+// Rebinds skeletons whose player switched clips and uploads the world transforms their root joints hang from.
+void prepare_animated_skeletons(flecs::iter& it) {
+    std::vector<glm::mat4> all_roots;
 
     if (!it.next()) return;
     auto context = it.field<RenderContext>(0);
+    GPUSkeletonJoint* records = static_cast<GPUSkeletonJoint*>(context->device.map_buffer(context->skeleton_buffer));
     do {
-        auto mesh = it.field<SkinnedMesh>(1);
+        auto skeleton = it.field<AnimatedSkeleton>(1);
         for (const auto i: it) {
-            uint32_t initial_joint = all_joints.size();
-            const std::vector<flecs::entity>& mesh_joints = mesh[i].joints;
-            all_joints.resize(all_joints.size() + mesh_joints.size());
-            for (uint32_t j = 0; j < mesh_joints.size(); j++) {
-                const Joint* joint = mesh_joints[j].get<Joint>();
-                const GlobalTransform* transform = mesh_joints[j].get<GlobalTransform>();
-                all_joints[initial_joint + joint->buffer_offset] = transform->transform * joint->inverse_bind;
+            const flecs::entity animation = skeleton[i].player.get<AnimationPlayer>()->animation;
+            if (skeleton[i].bound_animation != animation) {
+                bind_skeleton_tracks(skeleton[i], animation);
+                memcpy(records + skeleton[i].skeleton_offset, skeleton[i].records.data(), skeleton[i].records.size() * sizeof(GPUSkeletonJoint));
+            }
+
+            all_roots.resize(std::max<size_t>(all_roots.size(), skeleton[i].root_offset + skeleton[i].roots.size()));
+            for (uint32_t r = 0; r < skeleton[i].roots.size(); r++) {
+                const flecs::entity root = skeleton[i].roots[r];
+                const GlobalTransform* transform = root.is_valid() ? root.get<GlobalTransform>() : nullptr;
+                all_roots[skeleton[i].root_offset + r] = transform != nullptr ? glm::mat4(transform->transform) : glm::mat4(1.0f);
             }
-            it.entity(i).set<DynamicUniformIndex<SkinnedMesh>>({ initial_joint });
         }
     } while (it.next());
+    context->device.unmap_buffer(context->skeleton_buffer);
 
-    if (context->joint_buffer.buffer == VK_NULL_HANDLE) {
-        context->joint_buffer = context->device.create_buffer(BufferDescriptor {
-            .size = all_joints.size() * sizeof(glm::mat4),
-            .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
-        }).unwrap();
-        context->joint_buffer_index = context->device.add_binding(context->joint_buffer);
-    }
-    {
-        void* data = context->device.map_buffer(context->joint_buffer);
-        memcpy(data, all_joints.data(), all_joints.size() * sizeof(glm::mat4));
-        context->device.unmap_buffer(context->joint_buffer);
-    }
+    void* data = context->device.map_buffer(context->root_buffer);
+    memcpy(data, all_roots.data(), all_roots.size() * sizeof(glm::mat4));
+    context->device.unmap_buffer(context->root_buffer);
 }
 
 void prepare_lights(flecs::iter& it) {
     std::vector<LightUniform> all_lights{};
+    std::vector<glm::mat4> projections{};
+    std::vector<glm::mat4> views{};
 
     if (!it.next()) return;
     auto context = it.field<RenderContext>(0);
@@ -612,9 +1778,8 @@ void prepare_lights(flecs::iter& it) {
 
             LightUniform light_uniform { .color = light[i].color, .position = glm::vec4(-2.0f, 4.0f, -1.0f, 1.0f) };
 
-            glm::mat4 view = glm::lookAtLH(glm::vec3(-2.0f, 4.0f, -1.0f), glm::vec3( 0.0f, 0.0f,  0.0f), glm::vec3( 0.0f, 1.0f,  0.0f));
-            glm::mat4 projection = glm::orthoLH(-10.0f, 10.0f, -10.0f, 10.0f, 7.5f, 1.0f);
-            light_uniform.view_projection = projection * view;
+            views.push_back(glm::lookAtLH(glm::vec3(-2.0f, 4.0f, -1.0f), glm::vec3( 0.0f, 0.0f,  0.0f), glm::vec3( 0.0f, 1.0f,  0.0f)));
+            projections.push_back(glm::orthoLH(-10.0f, 10.0f, -10.0f, 10.0f, 7.5f, 1.0f));
 
             Texture depth_texture = context->device.create_texture(TextureDescriptor {
                 .size = context->extent,
@@ -644,6 +1809,12 @@ void prepare_lights(flecs::iter& it) {
         }
     } while (it.next());
 
+    std::vector<glm::mat4> view_projections(all_lights.size());
+    batch_multiply(projections, views, view_projections);
+    for (uint32_t i = 0; i < all_lights.size(); i++) {
+        all_lights[i].view_projection = view_projections[i];
+    }
+
     context->light_buffer = context->device.create_buffer(BufferDescriptor {
         .size = all_lights.size() * sizeof(LightUniform),
         .usage = BufferUsage::Storage | BufferUsage::MapReadWrite
@@ -670,7 +1841,7 @@ void prepare_textures(flecs::iter& it) {
             }).unwrap();
             {
                 void* data = context->device.map_buffer(buffer);
-                memcpy(data, cpu_texture[i].data.data(), cpu_texture[i].data.size());
+                memcpy(data, cpu_texture[i].data.get(), cpu_texture[i].width * cpu_texture[i].height * 4);
                 context->device.unmap_buffer(buffer);
             }
             Texture texture = context->device.create_texture(TextureDescriptor {
@@ -759,6 +1930,200 @@ void prepare_textures(flecs::iter& it) {
     }
 }
 
+// Skins the mesh on the CPU at every frame of the clip. Texels 2 * (frame * vertex_count + vertex)
+// and the one after it hold the position and the normal of that vertex, relative to the player.
+std::vector<glm::vec4> bake_vertex_animation(
+    const flecs::entity player,
+    const PackedAnimationClip& clip,
+    const Mesh& mesh,
+    const std::vector<flecs::entity>& joints,
+    const uint32_t frame_count,
+    const float sample_rate
+) {
+    const size_t vertex_count = mesh.vertices.size();
+    const size_t texel_count = 2 * frame_count * vertex_count;
+    std::vector<glm::vec4> texels((texel_count + VERTEX_ANIMATION_TEXTURE_WIDTH - 1) / VERTEX_ANIMATION_TEXTURE_WIDTH * VERTEX_ANIMATION_TEXTURE_WIDTH);
+
+    std::vector<glm::mat4> palette(joints.size(), glm::mat4(1.0f));
+    KeyframeCursors cursors{};
+    AnimationPose pose{};
+    for (uint32_t frame = 0; frame < frame_count; frame++) {
+        compose_pose_palette(player, clip, joints, frame / sample_rate, cursors, pose, palette.data());
+        for (size_t v = 0; v < vertex_count; v++) {
+            const Vertex& vertex = mesh.vertices[v];
+            const glm::mat4 skin_matrix = vertex.weights.x * palette[vertex.joints.x]
+                + vertex.weights.y * palette[vertex.joints.y]
+                + vertex.weights.z * palette[vertex.joints.z]
+                + vertex.weights.w * palette[vertex.joints.w];
+            const glm::vec3 normal = glm::mat3(skin_matrix) * glm::vec3(vertex.normal);
+            const size_t texel = 2 * (frame * vertex_count + v);
+            texels[texel] = skin_matrix * vertex.position;
+            texels[texel + 1] = glm::vec4(glm::length(normal) > 0.0f ? glm::normalize(normal) : normal, 0.0f);
+        }
+    }
+    return texels;
+}
+
+// Bakes the current clip of every LOD-managed character into a vertex animation texture. Instances
+// of the same Mesh playing the same clip share one texture.
+void prepare_vertex_animations(flecs::iter& it) {
+    std::vector<std::tuple<flecs::entity, flecs::entity, BakedVertexAnimation>> baked;
+    std::vector<Buffer> texture_buffers;
+    std::vector<Texture> textures;
+
+    if (!it.next()) return;
+    auto context = it.field<RenderContext>(0);
+    auto settings = it.field<const VertexAnimationSettings>(1);
+    do {
+        auto skinned_mesh = it.field<SkinnedMesh>(2);
+        for (const auto i: it) {
+            const std::vector<flecs::entity>& joints = skinned_mesh[i].joints;
+            if (joints.empty()) continue;
+            const flecs::entity player = find_animation_player(joints[0]);
+            if (!player.is_valid() || !player.has<AnimationLod>()) continue;
+
+            const flecs::entity clip = player.get<AnimationPlayer>()->animation;
+            flecs::entity skeleton = it.entity(i).target(flecs::IsA);
+            if (!skeleton.is_valid()) {
+                skeleton = it.entity(i);
+            }
+            const auto shared = std::ranges::find_if(baked, [&](const auto& b) { return std::get<0>(b) == skeleton && std::get<1>(b) == clip; });
+            if (shared != baked.end()) {
+                BakedVertexAnimation animation = std::get<2>(*shared);
+                animation.player = player;
+                it.entity(i).set<BakedVertexAnimation>(animation);
+                continue;
+            }
+
+            const Mesh* mesh = it.entity(i).get<Mesh>();
+            const PackedAnimationClip* packed_clip = clip.get<PackedAnimationClip>();
+            const uint32_t frame_count = static_cast<uint32_t>(std::ceil(packed_clip->duration * settings->sample_rate)) + 1;
+            const std::vector<glm::vec4> texels = bake_vertex_animation(player, *packed_clip, *mesh, joints, frame_count, settings->sample_rate);
+
+            Buffer buffer = context->device.create_buffer(BufferDescriptor {
+                .size = texels.size() * sizeof(glm::vec4),
+                .usage = BufferUsage::Storage | BufferUsage::MapReadWrite | BufferUsage::TransferSrc
+            }).unwrap();
+            {
+                void* data = context->device.map_buffer(buffer);
+                memcpy(data, texels.data(), texels.size() * sizeof(glm::vec4));
+                context->device.unmap_buffer(buffer);
+            }
+            Texture texture = context->device.create_texture(TextureDescriptor {
+                .size = Extent3d {
+                    .width = VERTEX_ANIMATION_TEXTURE_WIDTH,
+                    .height = static_cast<uint32_t>(texels.size() / VERTEX_ANIMATION_TEXTURE_WIDTH),
+                    .depth_or_array_layers = 1
+                },
+                .format = TextureFormat::Rgba32Float,
+                .usage = TextureUsage::Resource | TextureUsage::CopyDst,
+                .dimension = TextureDimension::D2,
+                .mip_level_count = 1,
+                .sample_count = 1
+            }).unwrap();
+            TextureView texture_view = context->device.create_texture_view(texture, TextureViewDescriptor {
+                .usage = TextureUsage::Resource,
+                .dimension = TextureDimension::D2,
+                .range = ImageSubresourceRange {
+                    .aspect = FormatAspect::Color,
+                    .base_mip_level = 0,
+                    .mip_level_count = 1,
+                    .base_array_layer = 0,
+                    .array_layer_count = 1
+                }
+            }).unwrap();
+            const uint32_t binding_index = context->device.add_binding(texture_view);
+            context->vertex_animation_textures.push_back(GPUTexture {
+                .texture = texture,
+                .view = texture_view,
+                .binding = binding_index
+            });
+
+            const BakedVertexAnimation animation {
+                .player = player,
+                .clip = clip,
+                .texture = binding_index,
+                .vertex_count = static_cast<uint32_t>(mesh->vertices.size()),
+                .frame_count = frame_count,
+                .sample_rate = settings->sample_rate
+            };
+            baked.emplace_back(skeleton, clip, animation);
+            it.entity(i).set<BakedVertexAnimation>(animation);
+
+            texture_buffers.push_back(buffer);
+            textures.push_back(texture);
+        }
+    } while (it.next());
+
+    if (textures.empty()) return;
+    context->encoder.begin_encoding().unwrap();
+    for (uint32_t i = 0; i < textures.size(); i++) {
+        {
+            std::array barriers {
+                TextureBarrier {
+                    .texture = &textures[i],
+                    .range = ImageSubresourceRange {
+                        .aspect = FormatAspect::Color,
+                        .base_mip_level = 0,
+                        .mip_level_count = 1,
+                        .base_array_layer = 0,
+                        .array_layer_count = 1
+                    },
+                    .before = TextureUsage::Undefined,
+                    .after = TextureUsage::CopyDst
+                }
+            };
+            context->encoder.transition_textures(barriers);
+        }
+        context->encoder.copy_buffer_to_texture(texture_buffers[i], textures[i], TextureUsage::CopyDst);
+        {
+            std::array barriers {
+                TextureBarrier {
+                    .texture = &textures[i],
+                    .range = ImageSubresourceRange {
+                        .aspect = FormatAspect::Color,
+                        .base_mip_level = 0,
+                        .mip_level_count = 1,
+                        .base_array_layer = 0,
+                        .array_layer_count = 1
+                    },
+                    .before = TextureUsage::CopyDst,
+                    .after = TextureUsage::ShaderReadOnly
+                }
+            };
+            context->encoder.transition_textures(barriers);
+        }
+    }
+    const auto command_buffer = context->encoder.end_encoding().unwrap();
+
+    std::array command_buffers { command_buffer };
+    context->queue.submit(command_buffers, {}, {}, context->render_fence).unwrap();
+
+    context->device.wait_for_fence(context->render_fence).unwrap();
+    context->encoder.reset_all(command_buffers);
+
+    for (const auto& buffer: texture_buffers) {
+        context->device.destroy_buffer(buffer);
+    }
+}
+
+// Switches a skinned mesh to its vertex animation while its player's LOD asks for it and the player
+// still plays the baked clip. The player is tagged too, so its pose is no longer evaluated.
+void select_vertex_animation(flecs::entity entity, const BakedVertexAnimation& animation) {
+    const AnimationPlayer* player = animation.player.get<AnimationPlayer>();
+    const AnimationLod* lod = animation.player.get<AnimationLod>();
+    const bool active = lod != nullptr && lod->vertex_animation && player->animation == animation.clip;
+    if (active == entity.has<VertexAnimationActive>()) return;
+
+    if (active) {
+        entity.add<VertexAnimationActive>();
+        animation.player.add<VertexAnimationActive>();
+    } else {
+        entity.remove<VertexAnimationActive>();
+        animation.player.remove<VertexAnimationActive>();
+    }
+}
+
 void prepare_sampler(flecs::entity entity, RenderContext& context, const CPUSampler& cpu_sampler) {
     const Sampler sampler = context.device.create_sampler(SamplerDescriptor {
         .min_filter = cpu_sampler.min_filter,
@@ -774,8 +2139,8 @@ void prepare_sampler(flecs::entity entity, RenderContext& context, const CPUSamp
 void prepare_view(RenderContext& context, const Camera& camera, const GlobalTransform& transform) {
     const ViewUniform view {
         .projection = camera.projection,
-        .view = glm::inverse(transform.transform),
-        .position = transform.transform[3]
+        .view = glm::inverse(glm::mat4(transform.transform)),
+        .position = glm::vec4(transform.transform[3], 1.0f)
     };
 
     if (context.view_buffer.buffer == VK_NULL_HANDLE) {
@@ -791,7 +2156,14 @@ void prepare_view(RenderContext& context, const Camera& camera, const GlobalTran
     context.device.unmap_buffer(context.view_buffer);
 }
 
-export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
+// fallback_adapter runs on the CPU adapter, such as lavapipe, even when a GPU is present.
+export struct RendererDescriptor {
+    bool fallback_adapter = false;
+};
+
+// Without a Window singleton the renderer is headless: every pass but the draws is still recorded
+// and submitted each frame, so compute results can be read back, e.g. by tests.
+export Result<void, VkResult> initialize_vulkan(const flecs::world& world, const RendererDescriptor& descriptor = {}) {
     Instance instance{};
     if (const auto res = instance.initialize(InstanceDescriptor{
         .validation = true,
@@ -800,31 +2172,51 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         return res;
     }
 
-    std::vector<Adapter> adapters = instance.enumerate_adapters().unwrap();
-    const Adapter adapter = *std::ranges::find_if(adapters.begin(), adapters.end(), [](const auto& a) { return a.info.type == DeviceType::Gpu; });
+    auto adapters_res = instance.enumerate_adapters();
+    if (adapters_res.is_err()) {
+        return Err(adapters_res.unwrap_err());
+    }
+    std::vector<Adapter> adapters = adapters_res.unwrap();
+    // Prefer a discrete GPU, but run on whatever is there otherwise (integrated GPUs, lavapipe). Fail
+    // rather than fall back when there is no adapter, or no CPU adapter was found for fallback_adapter.
+    const DeviceType preferred_type = descriptor.fallback_adapter ? DeviceType::Cpu : DeviceType::Gpu;
+    auto preferred_adapter = std::ranges::find_if(adapters, [&](const auto& a) { return a.info.type == preferred_type; });
+    if (preferred_adapter == adapters.end() && !descriptor.fallback_adapter) {
+        preferred_adapter = adapters.begin();
+    }
+    if (preferred_adapter == adapters.end()) {
+        return Err(VK_ERROR_INITIALIZATION_FAILED);
+    }
+    const Adapter adapter = *preferred_adapter;
 
     auto open_device = adapter.open().unwrap();
     Device device = std::get<0>(std::move(open_device));
     const Queue queue = std::get<1>(open_device);
 
     const Window* window = world.get<Window>();
-    auto surface_res = instance.create_surface(window->hwnd, window->hinstance);
-    if (surface_res.is_err()) {
-        return Err(surface_res.unwrap_err());
-    }
-    Surface surface = surface_res.unwrap();
-    SurfaceConfiguration surface_config {
-        .extent = Extent3d {
-            .width = window->width,
-            .height = window->height,
-            .depth_or_array_layers = 1
-        },
-        .present_mode = PresentMode::Mailbox,
-        .composite_alpha = CompositeAlphaMode::Opaque,
-        .format = TextureFormat::Rgba8Unorm
+    const bool headless = window == nullptr;
+    Extent3d extent {
+        .width = headless ? 1 : window->width,
+        .height = headless ? 1 : window->height,
+        .depth_or_array_layers = 1
     };
-    if (const auto res = surface.configure(device, queue, surface_config); res.is_err()) {
-        return res;
+
+    Surface surface{};
+    if (!headless) {
+        auto surface_res = instance.create_surface(window->hwnd, window->hinstance);
+        if (surface_res.is_err()) {
+            return Err(surface_res.unwrap_err());
+        }
+        surface = surface_res.unwrap();
+        SurfaceConfiguration surface_config {
+            .extent = extent,
+            .present_mode = PresentMode::Mailbox,
+            .composite_alpha = CompositeAlphaMode::Opaque,
+            .format = TextureFormat::Rgba8Unorm
+        };
+        if (const auto res = surface.configure(device, queue, surface_config); res.is_err()) {
+            return res;
+        }
     }
 
     auto command_res = device.create_command_encoder(CommandEncoderDescriptor { .queue = &queue });
@@ -863,6 +2255,12 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         .stage = ShaderStage::Vertex,
         .defines = { "MESH_SKINNING" }
     }).unwrap();
+    ShaderModule vertex_animation_shader = device.create_shader_module(ShaderModuleDescriptor {
+        .code = mesh_file,
+        .entrypoint = "VSMain",
+        .stage = ShaderStage::Vertex,
+        .defines = { "VERTEX_ANIMATION" }
+    }).unwrap();
     ShaderModule fragment_shader = device.create_shader_module(ShaderModuleDescriptor {
         .code = mesh_file,
         .entrypoint = "PSMain",
@@ -876,6 +2274,27 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         .stage = ShaderStage::Compute
     }).unwrap();
 
+    auto animation_file = read_file("../../assets/shaders/animation.hlsl");
+    ShaderModule animation_shader = device.create_shader_module(ShaderModuleDescriptor {
+        .code = animation_file,
+        .entrypoint = "cs_animate",
+        .stage = ShaderStage::Compute
+    }).unwrap();
+
+    auto transform_file = read_file("../../assets/shaders/transform.hlsl");
+    ShaderModule propagation_shader = device.create_shader_module(ShaderModuleDescriptor {
+        .code = transform_file,
+        .entrypoint = "cs_propagate",
+        .stage = ShaderStage::Compute
+    }).unwrap();
+
+    auto morph_file = read_file("../../assets/shaders/morph.hlsl");
+    ShaderModule morph_shader = device.create_shader_module(ShaderModuleDescriptor {
+        .code = morph_file,
+        .entrypoint = "cs_morph",
+        .stage = ShaderStage::Compute
+    }).unwrap();
+
     auto shadow_file = read_file("../../assets/shaders/shadow.hlsl");
     ShaderModule shadow_shader = device.create_shader_module(ShaderModuleDescriptor {
         .code = shadow_file,
@@ -888,6 +2307,12 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         .stage = ShaderStage::Vertex,
         .defines = { "MESH_SKINNING" }
     }).unwrap();
+    ShaderModule vertex_animation_shadow_shader = device.create_shader_module(ShaderModuleDescriptor {
+        .code = shadow_file,
+        .entrypoint = "VSMain",
+        .stage = ShaderStage::Vertex,
+        .defines = { "VERTEX_ANIMATION" }
+    }).unwrap();
 
     std::array render_format { TextureFormat::Rgba8Unorm };
     Pipeline mesh_pipeline = device.create_graphics_pipeline(RenderPipelineDescriptor{
@@ -910,9 +2335,28 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
             .compare = CompareFunction::GreaterEqual
         }
     }).unwrap();
+    Pipeline vertex_animation_pipeline = device.create_graphics_pipeline(RenderPipelineDescriptor{
+        .vertex_shader = &vertex_animation_shader,
+        .fragment_shader = &fragment_shader,
+        .render_format = render_format,
+        .depth_stencil = DepthStencilState {
+            .format = TextureFormat::D32,
+            .depth_write_enabled = true,
+            .compare = CompareFunction::GreaterEqual
+        }
+    }).unwrap();
     Pipeline skinning_pipeline = device.create_compute_pipeline(ComputePipelineDescriptor {
         .compute_shader = &skinning_shader
     }).unwrap();
+    Pipeline animation_pipeline = device.create_compute_pipeline(ComputePipelineDescriptor {
+        .compute_shader = &animation_shader
+    }).unwrap();
+    Pipeline morph_pipeline = device.create_compute_pipeline(ComputePipelineDescriptor {
+        .compute_shader = &morph_shader
+    }).unwrap();
+    Pipeline propagation_pipeline = device.create_compute_pipeline(ComputePipelineDescriptor {
+        .compute_shader = &propagation_shader
+    }).unwrap();
     Pipeline shadow_pipeline = device.create_graphics_pipeline(RenderPipelineDescriptor {
         .vertex_shader = &shadow_shader,
         .depth_stencil = DepthStencilState {
@@ -929,25 +2373,36 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
             .compare = CompareFunction::GreaterEqual
         }
     }).unwrap();
+    Pipeline vertex_animation_shadow_pipeline = device.create_graphics_pipeline(RenderPipelineDescriptor {
+        .vertex_shader = &vertex_animation_shadow_shader,
+        .depth_stencil = DepthStencilState {
+            .format = TextureFormat::D32,
+            .depth_write_enabled = true,
+            .compare = CompareFunction::GreaterEqual
+        }
+    }).unwrap();
 
     device.destroy_shader_module(vertex_shader);
     device.destroy_shader_module(skinned_vertex_shader);
+    device.destroy_shader_module(vertex_animation_shader);
     device.destroy_shader_module(fragment_shader);
     device.destroy_shader_module(skinning_shader);
+    device.destroy_shader_module(animation_shader);
     device.destroy_shader_module(shadow_shader);
     device.destroy_shader_module(skinned_shadow_shader);
+    device.destroy_shader_module(vertex_animation_shadow_shader);
 
     world.component<Mesh>().add(flecs::OnInstantiate, flecs::Inherit);
     world.component<GPUMesh>().add(flecs::OnInstantiate, flecs::Inherit);
+    world.component<GPUMorphTargets>().add(flecs::OnInstantiate, flecs::Inherit);
     world.component<Material>().add(flecs::OnInstantiate, flecs::Inherit);
     world.component<DynamicUniformIndex<Material>>().add(flecs::OnInstantiate, flecs::Inherit);
+    // Views and joint palettes are built on the CPU, so these keep their GlobalTransform with GPU propagation.
+    world.component<Camera>().add(flecs::With, world.component<CpuTransform>());
+    world.component<Joint>().add(flecs::With, world.component<CpuTransform>());
 
     Texture depth_texture = device.create_texture(TextureDescriptor {
-        .size = Extent3d {
-            .width = window->width,
-            .height = window->height,
-            .depth_or_array_layers = 1
-        },
+        .size = extent,
         .format = TextureFormat::D32,
         .usage = TextureUsage::DepthWrite,
         .dimension = TextureDimension::D2,
@@ -966,14 +2421,9 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         }
     }).unwrap();
 
-    Extent3d extent {
-        .width = window->width,
-        .height = window->height,
-        .depth_or_array_layers = 1
-    };
-
     RenderContext context{
         .extent = extent,
+        .headless = headless,
         .instance = instance,
         .adapter = adapter,
         .device = std::move(device),
@@ -986,16 +2436,22 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         .mesh_pipeline = mesh_pipeline,
         .skinned_mesh_pipeline = skinned_mesh_pipeline,
         .skinning_pipeline = skinning_pipeline,
+        .animation_pipeline = animation_pipeline,
         .shadow_pipeline = shadow_pipeline,
         .skinned_shadow_pipeline = skinned_shadow_pipeline,
+        .vertex_animation_pipeline = vertex_animation_pipeline,
+        .vertex_animation_shadow_pipeline = vertex_animation_shadow_pipeline,
+        .morph_pipeline = morph_pipeline,
+        .propagation_pipeline = propagation_pipeline,
         .depth_texture = depth_texture,
         .depth_texture_view = depth_texture_view,
     };
     world.set(context);
 
     RenderRunner runner {};
-    runner.mesh_query = world.query_builder<GPUMesh, DynamicUniformIndex<Material>, DynamicUniformIndex<GlobalTransform>>().without<SkinnedMesh>().build();
-    runner.skinned_mesh_query = world.query_builder<GPUMesh, DynamicUniformIndex<Material>, DynamicUniformIndex<GlobalTransform>>().with<SkinnedMesh>().build();
+    runner.mesh_query = world.query_builder<GPUMesh, DynamicUniformIndex<Material>, DynamicUniformIndex<GlobalTransform>, const MorphedMesh*>().without<SkinnedMesh>().build();
+    runner.skinned_mesh_query = world.query_builder<GPUMesh, DynamicUniformIndex<Material>, DynamicUniformIndex<GlobalTransform>>().with<SkinnedMesh>().without<VertexAnimationActive>().build();
+    runner.vertex_animation_query = world.query_builder<GPUMesh, DynamicUniformIndex<Material>, BakedVertexAnimation>().with<VertexAnimationActive>().build();
     runner.light_query = world.query<GPULight, DynamicUniformIndex<Light>>();
     world.set(runner);
 
@@ -1005,6 +2461,26 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         .kind(flecs::OnStart)
         .run(prepare_meshes);
 
+    world.system<RenderContext, Mesh>("Prepare Morph Targets")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .term_at(1).self()
+        .write<GPUMorphTargets>()
+        .kind(flecs::OnStart)
+        .run(prepare_morph_targets);
+
+    world.system<RenderContext>("Prepare Morphed Meshes")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .with<MorphWeights>()
+        .write<MorphedMesh>()
+        .kind(flecs::OnStart)
+        .run(prepare_morphed_meshes);
+
+    world.system<RenderContext, const MorphWeights, MorphedMesh>("Prepare Morph Weights")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .write<SkinnedPose>()
+        .kind(flecs::PreStore)
+        .run(prepare_morph_weights);
+
     world.system<RenderContext, CPUSampler>("Prepare Samplers")
         .term_at(0).singleton().inout(flecs::InOut)
         .write<GPUSampler>()
@@ -1027,16 +2503,70 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
 
     world.system<RenderContext, GlobalTransform>("Prepare Transforms")
         .term_at(0).singleton().inout(flecs::InOut)
+        .without<Static>()
         .kind(flecs::PreStore)
         .write<DynamicUniformIndex<GlobalTransform>>()
         .run(prepare_transforms);
 
-    world.system<RenderContext, SkinnedMesh>("Prepare Skinned Meshes")
+    world.system<RenderContext, TransformHierarchy, const TransformPropagationSettings>("Upload Transform Hierarchy")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .term_at(1).singleton()
+        .term_at(2).singleton()
+        .kind(flecs::PreStore)
+        .write<DynamicUniformIndex<GlobalTransform>>()
+        .each(upload_transform_hierarchy);
+
+    world.system<RenderContext, const GlobalTransform>("Bake Static Transforms")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .with<Static>()
+        .without<BakedTransform>()
+        .kind(flecs::PreStore)
+        .write<DynamicUniformIndex<GlobalTransform>>()
+        .write<BakedTransform>()
+        .run(bake_static_transforms);
+
+    world.set<PoseCacheSettings>({});
+    world.set(PoseCache {});
+    world.system<RenderContext, PoseCache, const PoseCacheSettings, SkinnedMesh>("Prepare Skinned Meshes")
         .term_at(0).singleton().inout(flecs::InOut)
+        .term_at(1).singleton()
+        .term_at(2).singleton()
         .kind(flecs::PreStore)
         .write<DynamicUniformIndex<SkinnedMesh>>()
+        .write<CachedSkinnedMesh>()
+        .write<SkinnedPose>()
         .run(prepare_skinned_meshes);
 
+    world.system<RenderContext, PackedAnimationClip>("Prepare Animations")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .write<GPUAnimationClip>()
+        .kind(flecs::OnStart)
+        .run(prepare_animations);
+
+    world.system<RenderContext, SkinnedMesh>("Prepare Skeletons")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .write<AnimatedSkeleton>()
+        .kind(flecs::OnStart)
+        .run(prepare_skeletons);
+
+    world.system<RenderContext, AnimatedSkeleton>("Prepare Animated Skeletons")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .kind(flecs::PreStore)
+        .run(prepare_animated_skeletons);
+
+    world.set<VertexAnimationSettings>({});
+    world.system<RenderContext, const VertexAnimationSettings, SkinnedMesh>("Prepare Vertex Animations")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .term_at(1).singleton()
+        .write<BakedVertexAnimation>()
+        .kind(flecs::OnStart)
+        .run(prepare_vertex_animations);
+
+    world.system<const BakedVertexAnimation>("Select Vertex Animations")
+        .write<VertexAnimationActive>()
+        .kind(flecs::PostUpdate)
+        .each(select_vertex_animation);
+
     world.system<RenderContext, Light>("Prepare Lights")
         .term_at(0).singleton().inout(flecs::InOut)
         .kind(flecs::OnStart)
@@ -1052,8 +2582,26 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         .kind(flecs::OnStore)
         .each(begin_render);
 
-    auto skin_mesh_system = world.system<RenderContext, GPUMesh, DynamicUniformIndex<SkinnedMesh>>("Skin Meshes")
+    auto propagate_transform_system = world.system<RenderContext, const TransformHierarchy>("Propagate Transforms On GPU")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .term_at(1).singleton()
+        .kind(flecs::OnStore)
+        .each(propagate_transforms_on_gpu);
+
+    auto morph_mesh_system = world.system<RenderContext, GPUMesh, const GPUMorphTargets, const MorphedMesh>("Morph Meshes")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .kind(flecs::OnStore)
+        .run(morph_meshes);
+
+    auto animate_skeleton_system = world.system<RenderContext, AnimatedSkeleton, DynamicUniformIndex<SkinnedMesh>, const SkinnedPose*>("Animate Skeletons")
+        .term_at(0).singleton().inout(flecs::InOut)
+        .without<VertexAnimationActive>()
+        .kind(flecs::OnStore)
+        .run(animate_skeletons);
+
+    auto skin_mesh_system = world.system<RenderContext, GPUMesh, DynamicUniformIndex<SkinnedMesh>, const CachedSkinnedMesh*, const SkinnedPose*, const MorphedMesh*>("Skin Meshes")
         .term_at(0).singleton().inout(flecs::InOut)
+        .without<VertexAnimationActive>()
         .kind(flecs::OnStore)
         .run(skin_meshes);
 
@@ -1074,7 +2622,10 @@ export Result<void, VkResult> initialize_vulkan(const flecs::world& world) {
         .kind(flecs::OnStore)
         .each(end_render);
 
-    skin_mesh_system.depends_on(begin_render_system);
+    propagate_transform_system.depends_on(begin_render_system);
+    morph_mesh_system.depends_on(propagate_transform_system);
+    animate_skeleton_system.depends_on(morph_mesh_system);
+    skin_mesh_system.depends_on(animate_skeleton_system);
     prepare_shadow_system.depends_on(skin_mesh_system);
     render_mesh_system.depends_on(prepare_shadow_system);
     end_render_system.depends_on(render_mesh_system);
@@ -1097,18 +2648,38 @@ export void destroy_vulkan(const flecs::world& world) {
         context->device.destroy_sampler(sampler.sampler);
     });
 
+    for (const GPUTexture& texture: context->vertex_animation_textures) {
+        context->device.destroy_texture_view(texture.view);
+        context->device.destroy_texture(texture.texture);
+    }
     context->device.destroy_texture_view(context->depth_texture_view);
     context->device.destroy_texture(context->depth_texture);
+    context->device.destroy_buffer(context->hierarchy_buffer);
+    context->device.destroy_buffer(context->morph_weight_buffer);
+    context->device.destroy_buffer(context->morph_vertex_buffer);
+    context->device.destroy_buffer(context->morph_buffer);
+    context->device.destroy_buffer(context->pose_buffer);
+    context->device.destroy_buffer(context->root_buffer);
+    context->device.destroy_buffer(context->skeleton_buffer);
+    context->device.destroy_buffer(context->animation_buffer);
     context->device.destroy_buffer(context->post_skinning_buffer);
     context->device.destroy_buffer(context->joint_buffer);
     context->device.destroy_buffer(context->light_buffer);
+    context->device.destroy_buffer(context->retired_static_transform_buffer);
+    context->device.destroy_buffer(context->static_transform_staging);
+    context->device.destroy_buffer(context->static_transform_buffer);
     context->device.destroy_buffer(context->transform_buffer);
     context->device.destroy_buffer(context->material_buffer);
     context->device.destroy_buffer(context->view_buffer);
     context->device.destroy_buffer(context->index_buffer);
     context->device.destroy_buffer(context->vertex_buffer);
+    context->device.destroy_pipeline(context->morph_pipeline);
+    context->device.destroy_pipeline(context->vertex_animation_shadow_pipeline);
+    context->device.destroy_pipeline(context->vertex_animation_pipeline);
     context->device.destroy_pipeline(context->skinned_shadow_pipeline);
     context->device.destroy_pipeline(context->shadow_pipeline);
+    context->device.destroy_pipeline(context->propagation_pipeline);
+    context->device.destroy_pipeline(context->animation_pipeline);
     context->device.destroy_pipeline(context->skinning_pipeline);
     context->device.destroy_pipeline(context->skinned_mesh_pipeline);
     context->device.destroy_pipeline(context->mesh_pipeline);
@@ -1122,6 +2693,31 @@ export void destroy_vulkan(const flecs::world& world) {
     context->instance.destroy();
 }
 
+// Copies the joint palette the last frame left in joint_buffer for a skinned mesh, whether the CPU or
+// the animation pass wrote it. Call between frames.
+export std::vector<glm::mat4> read_joint_palette(const flecs::entity skinned_mesh) {
+    const RenderContext* context = skinned_mesh.world().get<RenderContext>();
+    const uint32_t offset = skinned_mesh.get<DynamicUniformIndex<SkinnedMesh>>()->offset;
+    std::vector<glm::mat4> palette(skinned_mesh.get<SkinnedMesh>()->joints.size());
+
+    const auto* data = static_cast<const glm::mat4*>(context->device.map_buffer(context->joint_buffer));
+    std::copy_n(data + offset, palette.size(), palette.begin());
+    context->device.unmap_buffer(context->joint_buffer);
+    return palette;
+}
+
+// Copies the world matrices the last frame left in transform_buffer. With GPU propagation they are
+// indexed by HierarchyNode. Call between frames.
+export std::vector<glm::mat4x3> read_transform_buffer(const flecs::world& world) {
+    const RenderContext* context = world.get<RenderContext>();
+    std::vector<glm::mat4x3> transforms(context->transform_buffer.size / sizeof(glm::mat3x4));
+
+    const auto* data = static_cast<const glm::mat3x4*>(context->device.map_buffer(context->transform_buffer));
+    std::transform(data, data + transforms.size(), transforms.begin(), [](const glm::mat3x4& rows) { return glm::transpose(rows); });
+    context->device.unmap_buffer(context->transform_buffer);
+    return transforms;
+}
+
 std::string read_file(const std::string& filename) {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
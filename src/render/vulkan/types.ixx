@@ -41,6 +41,7 @@ export enum class PresentMode {
 
 export enum class TextureFormat {
     Rgba8Unorm,
+    Rgba32Float,
     D32
 };
 
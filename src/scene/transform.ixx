@@ -1,5 +1,15 @@
 module;
 
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <array>
+#include <span>
+#include <algorithm>
+#include <numeric>
+#include <execution>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x3.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -7,36 +17,374 @@ module;
 
 export module stellar.scene.transform;
 
+import stellar.math.batch;
+
 export struct Transform {
     glm::vec3 translation;
     glm::quat rotation;
     glm::vec3 scale;
+
+    bool operator==(const Transform&) const = default;
+};
+
+// Optional split columns of a Transform, so systems that only touch one part of it, such as
+// animation writing joint rotations, stream 12 or 16 bytes per entity instead of 40. An entity is
+// split when it has Translation; it then carries all three columns, as split_transform sets them, and
+// no Transform. Code that may see either kind goes through local_transform and set_local_transform.
+// Setting a Transform on a split entity still works: it is folded back into the columns.
+export struct Translation {
+    glm::vec3 value;
+};
+
+export struct Rotation {
+    glm::quat value;
 };
 
+export struct Scale {
+    glm::vec3 value;
+};
+
+export void split_transform(const flecs::entity entity) {
+    const Transform transform = *entity.get<Transform>();
+    entity.set<Translation>({ transform.translation })
+        .set<Rotation>({ transform.rotation })
+        .set<Scale>({ transform.scale })
+        .remove<Transform>();
+}
+
+// Whether entity takes part in propagation, through a Transform or its split columns.
+export bool has_local_transform(const flecs::entity entity) {
+    return entity.has<Transform>() || entity.has<Translation>();
+}
+
+// The local transform propagation uses for entity, from its split columns when it has them.
+export Transform local_transform(const flecs::entity entity) {
+    if (const Translation* translation = entity.get<Translation>()) {
+        return Transform {
+            .translation = translation->value,
+            .rotation = entity.get<Rotation>()->value,
+            .scale = entity.get<Scale>()->value
+        };
+    }
+    return *entity.get<Transform>();
+}
+
+export void set_local_transform(const flecs::entity entity, const Transform& transform) {
+    if (entity.has<Translation>()) {
+        entity.get_mut<Translation>()->value = transform.translation;
+        entity.get_mut<Rotation>()->value = transform.rotation;
+        entity.get_mut<Scale>()->value = transform.scale;
+    } else {
+        *entity.get_mut<Transform>() = transform;
+    }
+}
+
+// Every transform in the scene is affine, so world matrices keep only their top three rows: three
+// basis columns and the translation. glm::mat4(transform) restores the full matrix when needed.
+// changed_frame is the frame on which transform last changed, so consumers such as skinning can
+// skip hierarchies that did not move.
 export struct GlobalTransform {
-    glm::mat4 transform;
+    glm::mat4x3 transform;
+    uint64_t changed_frame = 0;
+};
+
+// Entities that never move after they are spawned. Their world transforms are baked once and are
+// not uploaded again, so changing the Transform of a Static entity has no visible effect.
+export struct Static {};
+
+export glm::mat4x3 compose_affine(const Transform& transform) {
+    const glm::mat3 rotation = glm::toMat3(transform.rotation);
+    return glm::mat4x3(rotation[0] * transform.scale.x, rotation[1] * transform.scale.y, rotation[2] * transform.scale.z, transform.translation);
+}
+
+// a * b for affine matrices, skipping the implicit bottom row.
+export glm::mat4x3 multiply_affine(const glm::mat4x3& a, const glm::mat4x3& b) {
+    const glm::mat3 linear(a);
+    return glm::mat4x3(linear * b[0], linear * b[1], linear * b[2], linear * b[3] + a[3]);
+}
+
+// With gpu set, the hierarchy is still flattened and its changes gathered on the CPU, but the render
+// plugin composes the world matrices in a compute pass, straight into its transform buffer.
+// GlobalTransform is then only kept up to date for CpuTransform entities. Choose the mode before
+// the first frame; switching it later is not supported.
+export struct TransformPropagationSettings {
+    bool gpu = false;
+};
+
+// Entities whose GlobalTransform is read on the CPU, such as cameras and skeleton joints. With GPU
+// propagation, only these and their ancestors are composed on the CPU.
+export struct CpuTransform {};
+
+export constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+// Index of a transformed entity in the flattened hierarchy.
+export struct HierarchyNode {
+    uint32_t index;
+};
+
+// Levels with fewer nodes than this are swept on the calling thread.
+constexpr uint32_t PARALLEL_LEVEL_SIZE = 1024;
+// Levels are swept in chunks of this many nodes, each composed through the batch kernels.
+constexpr uint32_t SWEEP_CHUNK_SIZE = 128;
+
+// Every transformed entity flattened into arrays sorted by depth, so each parent sits before its
+// children and propagation is one forward sweep. Level d spans [level_offsets[d], level_offsets[d + 1]);
+// nodes within a level are independent and are split into chunks starting at chunks[level_chunk_offsets[d]]
+// up to chunks[level_chunk_offsets[d + 1]]. translations, rotations and scales hold the local
+// transforms the world matrices were last composed from, one column each. Rebuilt only when the
+// hierarchy changes, which bumps version.
+// With GPU propagation, changed is left set after propagation for the render plugin, which uploads
+// the changed locals and clears it. cpu_nodes marks the nodes still composed on the CPU.
+export struct TransformHierarchy {
+    std::vector<uint32_t> parents;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4x3> worlds;
+    std::vector<uint8_t> changed;
+    std::vector<uint8_t> cpu_nodes;
+    std::vector<uint32_t> level_offsets;
+    std::vector<uint32_t> chunks;
+    std::vector<uint32_t> level_chunk_offsets;
+    uint64_t version = 0;
+    bool dirty = true;
+
+    // Both match every entity with a Transform or a Translation.
+    flecs::query<const HierarchyNode, const HierarchyNode*> order_query;
+    flecs::query<const HierarchyNode, GlobalTransform> node_query;
+    // Gather the locals of unsplit entities from Transform and of split ones from each column.
+    flecs::query<const Transform, const HierarchyNode> transform_query;
+    flecs::query<const Translation, const HierarchyNode> translation_query;
+    flecs::query<const Rotation, const HierarchyNode> rotation_query;
+    flecs::query<const Scale, const HierarchyNode> scale_query;
 };
 
+void rebuild_hierarchy(TransformHierarchy& hierarchy) {
+    std::vector<flecs::entity> entities;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> depths;
+    std::vector<Transform> locals;
+    std::vector<uint8_t> cpu_nodes;
+    hierarchy.order_query.each([&](const flecs::entity entity, const HierarchyNode&, const HierarchyNode* parent_node) {
+        const flecs::entity parent_entity = entity.parent();
+        const bool has_parent = parent_node != nullptr && has_local_transform(parent_entity);
+        const uint32_t parent = has_parent ? parent_entity.get<HierarchyNode>()->index : NO_PARENT;
+        entity.get_mut<HierarchyNode>()->index = entities.size();
+        entities.push_back(entity);
+        parents.push_back(parent);
+        depths.push_back(parent != NO_PARENT ? depths[parent] + 1 : 0);
+        locals.push_back(local_transform(entity));
+        cpu_nodes.push_back(entity.has<CpuTransform>());
+    });
+
+    // Cascade only orders by depth in the ChildOf tree, which can differ from the depth among
+    // transformed entities, so bucket the nodes by their own depth.
+    const uint32_t count = entities.size();
+    const uint32_t level_count = count > 0 ? *std::ranges::max_element(depths) + 1 : 0;
+    hierarchy.level_offsets.assign(level_count + 1, 0);
+    for (const uint32_t depth: depths) {
+        hierarchy.level_offsets[depth + 1]++;
+    }
+    std::partial_sum(hierarchy.level_offsets.begin(), hierarchy.level_offsets.end(), hierarchy.level_offsets.begin());
+
+    std::vector<uint32_t> remap(count);
+    std::vector<uint32_t> next(hierarchy.level_offsets.begin(), hierarchy.level_offsets.end() - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        remap[i] = next[depths[i]]++;
+    }
+
+    hierarchy.parents.resize(count);
+    hierarchy.translations.resize(count);
+    hierarchy.rotations.resize(count);
+    hierarchy.scales.resize(count);
+    hierarchy.cpu_nodes.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        hierarchy.parents[remap[i]] = parents[i] != NO_PARENT ? remap[parents[i]] : NO_PARENT;
+        hierarchy.translations[remap[i]] = locals[i].translation;
+        hierarchy.rotations[remap[i]] = locals[i].rotation;
+        hierarchy.scales[remap[i]] = locals[i].scale;
+        hierarchy.cpu_nodes[remap[i]] = cpu_nodes[i];
+        entities[i].get_mut<HierarchyNode>()->index = remap[i];
+    }
+    // Children come after their parents, so walking backwards marks every ancestor of a CPU node.
+    for (uint32_t i = count; i-- > 0;) {
+        if (hierarchy.cpu_nodes[i] && hierarchy.parents[i] != NO_PARENT) {
+            hierarchy.cpu_nodes[hierarchy.parents[i]] = 1;
+        }
+    }
+    hierarchy.chunks.clear();
+    hierarchy.level_chunk_offsets.assign(1, 0);
+    for (uint32_t level = 0; level < level_count; level++) {
+        for (uint32_t start = hierarchy.level_offsets[level]; start < hierarchy.level_offsets[level + 1]; start += SWEEP_CHUNK_SIZE) {
+            hierarchy.chunks.push_back(start);
+        }
+        hierarchy.level_chunk_offsets.push_back(hierarchy.chunks.size());
+    }
+    hierarchy.worlds.resize(count);
+    hierarchy.changed.assign(count, 1);
+    hierarchy.version++;
+    hierarchy.dirty = false;
+}
+
+// Gathers the nodes of [begin, end) that need a new world matrix, composes them all with the batch
+// kernels and scatters the results back. Roots are multiplied by the identity.
+void sweep_chunk(TransformHierarchy& hierarchy, const uint32_t begin, const uint32_t end, const bool cpu_only) {
+    std::array<uint32_t, SWEEP_CHUNK_SIZE> indices;
+    std::array<glm::vec3, SWEEP_CHUNK_SIZE> translations;
+    std::array<glm::quat, SWEEP_CHUNK_SIZE> rotations;
+    std::array<glm::vec3, SWEEP_CHUNK_SIZE> scales;
+    std::array<glm::mat4x3, SWEEP_CHUNK_SIZE> parents;
+    std::array<glm::mat4x3, SWEEP_CHUNK_SIZE> worlds;
+
+    uint32_t count = 0;
+    for (uint32_t i = begin; i < end; i++) {
+        if (cpu_only && !hierarchy.cpu_nodes[i]) continue;
+        const uint32_t parent = hierarchy.parents[i];
+        if (parent != NO_PARENT) {
+            hierarchy.changed[i] |= hierarchy.changed[parent];
+        }
+        if (!hierarchy.changed[i]) continue;
+
+        indices[count] = i;
+        translations[count] = hierarchy.translations[i];
+        rotations[count] = hierarchy.rotations[i];
+        scales[count] = hierarchy.scales[i];
+        parents[count] = parent != NO_PARENT ? hierarchy.worlds[parent] : glm::mat4x3(1.0f);
+        count++;
+    }
+    if (count == 0) return;
+
+    const std::span<glm::mat4x3> chunk_worlds(worlds.data(), count);
+    batch_compose_affine(std::span(translations.data(), count), std::span(rotations.data(), count), std::span(scales.data(), count), chunk_worlds);
+    batch_multiply_affine(std::span(parents.data(), count), chunk_worlds, chunk_worlds);
+    for (uint32_t k = 0; k < count; k++) {
+        hierarchy.worlds[indices[k]] = worlds[k];
+    }
+}
+
+void propagate_transforms(flecs::iter& it, size_t, TransformHierarchy& hierarchy, const TransformPropagationSettings& settings) {
+    const uint64_t frame = it.world().get_info()->frame_count_total;
+    if (hierarchy.dirty) {
+        rebuild_hierarchy(hierarchy);
+    }
+
+    // Gather: flag nodes whose local transform differs from the one their world matrix was built from.
+    const auto gather = [&]<typename T>(std::vector<T>& column, const uint32_t index, const T& value) {
+        if (column[index] != value) {
+            column[index] = value;
+            hierarchy.changed[index] = 1;
+        }
+    };
+    hierarchy.transform_query.each([&](const Transform& transform, const HierarchyNode& node) {
+        gather(hierarchy.translations, node.index, transform.translation);
+        gather(hierarchy.rotations, node.index, transform.rotation);
+        gather(hierarchy.scales, node.index, transform.scale);
+    });
+    hierarchy.translation_query.each([&](const Translation& translation, const HierarchyNode& node) {
+        gather(hierarchy.translations, node.index, translation.value);
+    });
+    hierarchy.rotation_query.each([&](const Rotation& rotation, const HierarchyNode& node) {
+        gather(hierarchy.rotations, node.index, rotation.value);
+    });
+    hierarchy.scale_query.each([&](const Scale& scale, const HierarchyNode& node) {
+        gather(hierarchy.scales, node.index, scale.value);
+    });
+
+    // Sweep level by level: a node only reads its parent, which the previous level finished, so the
+    // nodes of one level are spread across threads and the end of the level is the barrier.
+    for (uint32_t level = 0; level + 1 < hierarchy.level_offsets.size(); level++) {
+        const uint32_t level_end = hierarchy.level_offsets[level + 1];
+        const auto begin = hierarchy.chunks.begin() + hierarchy.level_chunk_offsets[level];
+        const auto end = hierarchy.chunks.begin() + hierarchy.level_chunk_offsets[level + 1];
+        const auto sweep = [&](const uint32_t start) { sweep_chunk(hierarchy, start, std::min(start + SWEEP_CHUNK_SIZE, level_end), settings.gpu); };
+        if (level_end - hierarchy.level_offsets[level] >= PARALLEL_LEVEL_SIZE) {
+            std::for_each(std::execution::par, begin, end, sweep);
+        } else {
+            std::for_each(begin, end, sweep);
+        }
+    }
+
+    // Scatter: only changed nodes are written back, in place.
+    hierarchy.node_query.each([&](const HierarchyNode& node, GlobalTransform& global) {
+        if (!hierarchy.changed[node.index] || (settings.gpu && !hierarchy.cpu_nodes[node.index])) return;
+        global.transform = hierarchy.worlds[node.index];
+        global.changed_frame = frame;
+    });
+    if (!settings.gpu) {
+        std::fill(hierarchy.changed.begin(), hierarchy.changed.end(), 0);
+    }
+}
+
 export void initialize_transform_plugin(const flecs::world& world) {
-    world.system<Transform, GlobalTransform*>("Propagate Transforms")
+    // Every transformed entity gets its GlobalTransform up front, so propagation can write it in place.
+    world.component<Transform>()
+        .add(flecs::With, world.component<GlobalTransform>())
+        .add(flecs::With, world.component<HierarchyNode>());
+    world.component<Translation>()
+        .add(flecs::With, world.component<GlobalTransform>())
+        .add(flecs::With, world.component<HierarchyNode>());
+
+    TransformHierarchy hierarchy {};
+    // Cascade orders tables by depth, which gives the parent-before-child order of the flat arrays.
+    hierarchy.order_query = world.query_builder<const HierarchyNode, const HierarchyNode*>()
         .term_at(1).parent().cascade().optional()
+        .with<Transform>().or_().with<Translation>()
+        .build();
+    hierarchy.node_query = world.query_builder<const HierarchyNode, GlobalTransform>()
+        .with<Transform>().or_().with<Translation>()
+        .build();
+    hierarchy.transform_query = world.query_builder<const Transform, const HierarchyNode>()
+        .without<Translation>()
+        .build();
+    hierarchy.translation_query = world.query<const Translation, const HierarchyNode>();
+    hierarchy.rotation_query = world.query<const Rotation, const HierarchyNode>();
+    hierarchy.scale_query = world.query<const Scale, const HierarchyNode>();
+    world.set(hierarchy);
+    world.set<TransformPropagationSettings>({});
+
+    world.observer<Transform>()
+        .event(flecs::OnAdd)
+        .event(flecs::OnRemove)
+        .each([](flecs::entity entity, Transform&) {
+            entity.world().get_mut<TransformHierarchy>()->dirty = true;
+        });
+    world.observer<Translation>()
+        .event(flecs::OnAdd)
+        .event(flecs::OnRemove)
+        .each([](flecs::entity entity, Translation&) {
+            entity.world().get_mut<TransformHierarchy>()->dirty = true;
+        });
+    // A Transform set on a split entity, e.g. by gameplay code unaware of the split, is moved into
+    // its columns rather than being ignored by propagation.
+    world.observer<const Transform>()
+        .event(flecs::OnSet)
+        .each([](flecs::entity entity, const Transform& transform) {
+            if (!entity.has<Translation>()) return;
+            entity.set<Translation>({ transform.translation })
+                .set<Rotation>({ transform.rotation })
+                .set<Scale>({ transform.scale })
+                .remove<Transform>();
+        });
+    world.observer()
+        .with<CpuTransform>()
+        .event(flecs::OnAdd)
+        .event(flecs::OnRemove)
+        .each([](flecs::entity entity) {
+            entity.world().get_mut<TransformHierarchy>()->dirty = true;
+        });
+    world.observer()
+        .with(flecs::ChildOf, flecs::Wildcard)
+        .event(flecs::OnAdd)
+        .event(flecs::OnRemove)
+        .each([](flecs::entity entity) {
+            entity.world().get_mut<TransformHierarchy>()->dirty = true;
+        });
+
+    world.system<TransformHierarchy, const TransformPropagationSettings>("Propagate Transforms")
+        .term_at(0).singleton()
+        .term_at(1).singleton()
+        .write<HierarchyNode>()
         .write<GlobalTransform>()
         .kind(flecs::PostUpdate)
-        .each([](flecs::entity entity, const Transform transform, GlobalTransform* parent_transform) {
-            glm::mat4 translation_mat = glm::translate(glm::mat4(1.0f), transform.translation);
-            glm::mat4 rotation_mat = glm::toMat4(transform.rotation);
-            glm::mat4 scale_mat = glm::scale(glm::mat4(1.0f), transform.scale);
-
-            glm::mat4 trans = translation_mat * rotation_mat * scale_mat;
-
-            if (parent_transform != nullptr) {
-                entity.set<GlobalTransform>(GlobalTransform{
-                    .transform = parent_transform->transform * trans
-                });
-            } else {
-                entity.set<GlobalTransform>(GlobalTransform{
-                    .transform = trans
-                });
-            }
-        });
-}
\ No newline at end of file
+        .each(propagate_transforms);
+}
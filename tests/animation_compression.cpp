@@ -0,0 +1,75 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <glm/gtx/quaternion.hpp>
+
+import stellar.animation;
+import stellar.animation.compression;
+
+// A joint turning slowly at a constant rate is exactly what linear key reduction exists for: every
+// inner key lies on the nlerp between the end points, far within the default rotation tolerance.
+// The rotation error metric must resolve such small angles, or only bit-identical keys are removed.
+// A translation track keyed on the same timestamps that only starts moving halfway must keep its
+// timeline shared with the rotation, so the rotation keeps the key where the translation turns.
+constexpr uint32_t KEY_COUNT = 61;
+constexpr float KEY_INTERVAL = 1.0f / 30.0f;
+constexpr float RADIANS_PER_KEY = 0.002f;
+
+int main() {
+    int result = 0;
+
+    const glm::vec3 axis(0.0f, 1.0f, 0.0f);
+    const float small_angle = 1e-4f;
+    const float measured = key_error(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::angleAxis(small_angle, axis));
+    std::printf("key error of a %g radian rotation: %g\n", small_angle, measured);
+    if (std::abs(measured - small_angle) > 0.1f * small_angle) {
+        std::fprintf(stderr, "rotation key error does not resolve small angles\n");
+        result = 1;
+    }
+
+    AnimationCurve curve {
+        .joint_index = 0,
+        .keyframes = Keyframes { Keyframes::Rotation {} },
+        .interpolation = Interpolation::Linear
+    };
+    auto& rotations = std::get<Keyframes::Rotation>(curve.keyframes.frames).rotations;
+    for (uint32_t k = 0; k < KEY_COUNT; k++) {
+        curve.keyframe_timestamps.push_back(k * KEY_INTERVAL);
+        rotations.push_back(glm::angleAxis(k * RADIANS_PER_KEY, axis));
+    }
+    AnimationCurve shared {
+        .joint_index = 0,
+        .keyframe_timestamps = curve.keyframe_timestamps,
+        .keyframes = Keyframes { Keyframes::Translation {} },
+        .interpolation = Interpolation::Linear
+    };
+    auto& translations = std::get<Keyframes::Translation>(shared.keyframes.frames).translations;
+    for (uint32_t k = 0; k < KEY_COUNT; k++) {
+        translations.push_back(glm::vec3(k < KEY_COUNT / 2 ? 0.0f : 0.1f * (k - KEY_COUNT / 2), 0.0f, 0.0f));
+    }
+
+    const AnimationClip single = compress_animation_clip(AnimationClip {
+        .curves = { curve },
+        .duration = (KEY_COUNT - 1) * KEY_INTERVAL
+    }, CompressionSettings {});
+    const AnimationClip compressed = compress_animation_clip(AnimationClip {
+        .curves = { curve, shared },
+        .duration = (KEY_COUNT - 1) * KEY_INTERVAL
+    }, CompressionSettings {});
+
+    const size_t kept = single.curves[0].keyframe_timestamps.size();
+    std::printf("slowly rotating track: %u keys reduced to %zu\n", KEY_COUNT, kept);
+    if (kept != 2) {
+        std::fprintf(stderr, "a constant-rate rotation should reduce to its two end keys\n");
+        result = 1;
+    }
+
+    const std::vector<float>& rotation_timeline = compressed.curves[0].keyframe_timestamps;
+    std::printf("rotation sharing a timeline with translation: %u keys reduced to %zu\n", KEY_COUNT, rotation_timeline.size());
+    if (rotation_timeline != compressed.curves[1].keyframe_timestamps || rotation_timeline.size() != 3) {
+        std::fprintf(stderr, "curves on a shared timeline should keep the same three keys\n");
+        result = 1;
+    }
+    return result;
+}
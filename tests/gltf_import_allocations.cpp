@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+import stellar.assets.gltf;
+import stellar.render.vulkan.plugin;
+import stellar.render.primitives;
+import stellar.core.result;
+
+// Imports a synthetic GLB while counting every heap allocation, and checks that import never holds
+// much more than what it returns. The file is mapped rather than allocated, so the bar is the size
+// of the imported asset itself: the decoded pixels and vertices the caller ends up owning. A peak
+// above 1.2 times that means a payload was copied on its way through instead of moved.
+constexpr double MAX_PEAK_RATIO = 1.2;
+
+constexpr uint32_t IMAGE_SIZE = 1024;
+constexpr uint32_t GRID_SIZE = 128;
+
+std::atomic<size_t> current_bytes = 0;
+std::atomic<size_t> peak_bytes = 0;
+
+// Each block starts with its size and the offset back to the start of the malloc'd memory.
+constexpr size_t HEADER_SIZE = 2 * sizeof(size_t);
+
+void* counted_allocate(const size_t size, size_t alignment) {
+    alignment = std::max<size_t>(alignment, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    auto* block = static_cast<std::byte*>(std::malloc(size + alignment + HEADER_SIZE));
+    if (block == nullptr) return nullptr;
+    const uintptr_t start = reinterpret_cast<uintptr_t>(block) + HEADER_SIZE;
+    auto* pointer = reinterpret_cast<std::byte*>((start + alignment - 1) & ~(alignment - 1));
+    const size_t header[2] { size, static_cast<size_t>(pointer - block) };
+    memcpy(pointer - HEADER_SIZE, header, HEADER_SIZE);
+
+    const size_t current = current_bytes.fetch_add(size) + size;
+    size_t peak = peak_bytes.load();
+    while (current > peak && !peak_bytes.compare_exchange_weak(peak, current)) {}
+    return pointer;
+}
+
+void counted_free(void* pointer) {
+    if (pointer == nullptr) return;
+    size_t header[2];
+    memcpy(header, static_cast<std::byte*>(pointer) - HEADER_SIZE, HEADER_SIZE);
+    current_bytes.fetch_sub(header[0]);
+    std::free(static_cast<std::byte*>(pointer) - header[1]);
+}
+
+void* counted_allocate_or_throw(const size_t size, const size_t alignment) {
+    void* pointer = counted_allocate(size, alignment);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size) { return counted_allocate_or_throw(size, 0); }
+void* operator new[](size_t size) { return counted_allocate_or_throw(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return counted_allocate_or_throw(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return counted_allocate_or_throw(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted_allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return counted_allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return counted_allocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return counted_allocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* pointer) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { counted_free(pointer); }
+
+template<typename T>
+void append(std::vector<std::byte>& bytes, const T& value) {
+    const auto* begin = reinterpret_cast<const std::byte*>(&value);
+    bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+// One mesh, a GRID_SIZE x GRID_SIZE grid, and one uncompressed 32-bit TGA image, which stb_image
+// decodes into a single allocation of exactly its pixels.
+void write_synthetic_glb(const std::filesystem::path& path) {
+    std::vector<std::byte> binary;
+    for (uint32_t y = 0; y + 1 < GRID_SIZE; y++) {
+        for (uint32_t x = 0; x + 1 < GRID_SIZE; x++) {
+            const uint32_t corner = y * GRID_SIZE + x;
+            for (const uint32_t index: { corner, corner + 1, corner + GRID_SIZE, corner + 1, corner + GRID_SIZE + 1, corner + GRID_SIZE }) {
+                append(binary, index);
+            }
+        }
+    }
+    const size_t index_count = binary.size() / sizeof(uint32_t);
+    const size_t positions_offset = binary.size();
+    for (uint32_t y = 0; y < GRID_SIZE; y++) {
+        for (uint32_t x = 0; x < GRID_SIZE; x++) {
+            const float position[3] { static_cast<float>(x), static_cast<float>(y), 0.0f };
+            append(binary, position);
+        }
+    }
+    const size_t image_offset = binary.size();
+    const uint8_t tga_header[18] { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        IMAGE_SIZE & 0xFF, IMAGE_SIZE >> 8, IMAGE_SIZE & 0xFF, IMAGE_SIZE >> 8, 32, 0x28 };
+    append(binary, tga_header);
+    for (uint32_t i = 0; i < IMAGE_SIZE * IMAGE_SIZE; i++) {
+        const uint8_t pixel[4] { static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i >> 16), 0xFF };
+        append(binary, pixel);
+    }
+    const size_t image_length = binary.size() - image_offset;
+    binary.resize((binary.size() + 3) & ~size_t(3));
+
+    const size_t vertex_count = GRID_SIZE * GRID_SIZE;
+    std::string json = "{\"asset\":{\"version\":\"2.0\"},"
+        "\"buffers\":[{\"byteLength\":" + std::to_string(binary.size()) + "}],"
+        "\"bufferViews\":["
+            "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(positions_offset) + "},"
+            "{\"buffer\":0,\"byteOffset\":" + std::to_string(positions_offset) + ",\"byteLength\":" + std::to_string(image_offset - positions_offset) + "},"
+            "{\"buffer\":0,\"byteOffset\":" + std::to_string(image_offset) + ",\"byteLength\":" + std::to_string(image_length) + "}],"
+        "\"accessors\":["
+            "{\"bufferView\":0,\"componentType\":5125,\"count\":" + std::to_string(index_count) + ",\"type\":\"SCALAR\"},"
+            "{\"bufferView\":1,\"componentType\":5126,\"count\":" + std::to_string(vertex_count) + ",\"type\":\"VEC3\"}],"
+        "\"images\":[{\"bufferView\":2,\"mimeType\":\"image/x-tga\"}],"
+        "\"textures\":[{\"source\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":1},\"indices\":0}]}],"
+        "\"nodes\":[{\"mesh\":0}],"
+        "\"scenes\":[{\"nodes\":[0]}],"
+        "\"scene\":0}";
+    json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+    std::vector<std::byte> file;
+    append(file, uint32_t { 0x46546C67 });
+    append(file, uint32_t { 2 });
+    append(file, static_cast<uint32_t>(12 + 8 + json.size() + 8 + binary.size()));
+    append(file, static_cast<uint32_t>(json.size()));
+    append(file, uint32_t { 0x4E4F534A });
+    file.insert(file.end(), reinterpret_cast<const std::byte*>(json.data()), reinterpret_cast<const std::byte*>(json.data() + json.size()));
+    append(file, static_cast<uint32_t>(binary.size()));
+    append(file, uint32_t { 0x004E4942 });
+    file.insert(file.end(), binary.begin(), binary.end());
+
+    std::ofstream stream(path, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+}
+
+int main() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "stellar_import_allocations.glb";
+    write_synthetic_glb(path);
+
+    const size_t start_bytes = current_bytes.load();
+    peak_bytes = start_bytes;
+    auto result = load_gltf(path);
+    const size_t peak = peak_bytes.load() - start_bytes;
+    std::filesystem::remove(path);
+    if (result.is_err()) {
+        std::fprintf(stderr, "import failed: %s\n", result.unwrap_err().c_str());
+        return 1;
+    }
+
+    const Gltf gltf = std::move(result).unwrap();
+    size_t payload = 0;
+    for (const CPUTexture& texture: gltf.textures) {
+        payload += static_cast<size_t>(texture.width) * texture.height * 4;
+    }
+    for (const GltfMesh& mesh: gltf.meshes) {
+        payload += mesh.mesh.vertices.size() * sizeof(Vertex) + (mesh.mesh.indices ? mesh.mesh.indices->size() : 0) * sizeof(uint32_t);
+    }
+    if (gltf.textures.size() != 1 || gltf.meshes.size() != 1) {
+        std::fprintf(stderr, "expected one texture and one mesh, got %zu and %zu\n", gltf.textures.size(), gltf.meshes.size());
+        return 1;
+    }
+
+    const double ratio = static_cast<double>(peak) / static_cast<double>(payload);
+    std::printf("peak heap during import %zu bytes, imported asset %zu bytes, ratio %.3f\n", peak, payload, ratio);
+    if (ratio > MAX_PEAK_RATIO) {
+        std::fprintf(stderr, "peak heap during import is above %.1fx the imported asset\n", MAX_PEAK_RATIO);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include "ecs/ecs.hpp"
+
+import stellar.render.vulkan.plugin;
+import stellar.animation;
+import stellar.scene.transform;
+
+// Poses the same small skeleton twice on the fallback adapter, once through the animation compute
+// pass (GPUAnimation) and once on the CPU, where write_joint_palette builds the palette from the
+// propagated joints. Both palettes end up in joint_buffer; they must match at every seek time.
+constexpr float MAX_ERROR = 1e-3f;
+constexpr uint32_t JOINT_COUNT = 4;
+constexpr float SEEK_TIMES[] { 0.3f, 0.85f };
+
+AnimationCurve rotation_curve(const uint32_t joint, const glm::vec3& axis) {
+    return AnimationCurve {
+        .joint_index = joint,
+        .keyframe_timestamps = { 0.0f, 0.5f, 1.0f },
+        .keyframes = Keyframes { Keyframes::Rotation {
+            .rotations = { glm::angleAxis(0.0f, axis), glm::angleAxis(1.2f, axis), glm::angleAxis(-0.7f, axis) }
+        } },
+        .interpolation = Interpolation::Linear
+    };
+}
+
+// Joint 3 has no track, so both paths keep its current Transform.
+PackedAnimationClip make_clip() {
+    AnimationClip clip { .duration = 1.0f };
+    clip.curves.push_back(rotation_curve(0, glm::vec3(0.0f, 1.0f, 0.0f)));
+    clip.curves.push_back(rotation_curve(1, glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f))));
+    clip.curves.push_back(AnimationCurve {
+        .joint_index = 1,
+        .keyframe_timestamps = { 0.0f, 1.0f },
+        .keyframes = Keyframes { Keyframes::Translation {
+            .translations = { glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.5f, 1.5f, -0.25f) }
+        } },
+        .interpolation = Interpolation::Linear
+    });
+    clip.curves.push_back(AnimationCurve {
+        .joint_index = 2,
+        .keyframe_timestamps = { 0.0f, 0.25f, 1.0f },
+        .keyframes = Keyframes { Keyframes::Scale {
+            .scales = { glm::vec3(1.0f), glm::vec3(1.5f, 0.5f, 1.0f), glm::vec3(0.75f) }
+        } },
+        .interpolation = Interpolation::Step
+    });
+    return pack_animation_clip(clip);
+}
+
+// Returns the skinned mesh of a character playing clip at a fixed seek time. Joints 1 and 2 hang
+// below joint 0 in a chain and joint 3 branches off joint 0. Palette slots run backwards to exercise
+// Joint::buffer_offset.
+flecs::entity spawn_character(const flecs::world& world, const flecs::entity clip, const bool gpu) {
+    const flecs::entity player = world.entity()
+        .set<Transform>(Transform {
+            .translation = glm::vec3(2.0f, 0.0f, 1.0f),
+            .rotation = glm::angleAxis(0.4f, glm::vec3(0.0f, 1.0f, 0.0f)),
+            .scale = glm::vec3(1.0f)
+        })
+        .set<AnimationPlayer>(AnimationPlayer {
+            .animation = clip,
+            .active_animation = ActiveAnimation {
+                .speed = 0.0f,
+                .playing = true,
+                .seek_time = 0.0f
+            }
+        });
+    if (gpu) {
+        player.add<GPUAnimation>();
+    }
+
+    std::vector<flecs::entity> joints;
+    const uint32_t parents[JOINT_COUNT] { 0, 0, 1, 0 };
+    for (uint32_t j = 0; j < JOINT_COUNT; j++) {
+        const Transform rest {
+            .translation = glm::vec3(0.0f, j == 0 ? 0.0f : 1.0f, j == 3 ? 0.5f : 0.0f),
+            .rotation = glm::angleAxis(0.1f * j, glm::vec3(0.0f, 0.0f, 1.0f)),
+            .scale = glm::vec3(1.0f)
+        };
+        const glm::mat4 bind = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, static_cast<float>(j), 0.0f));
+        const flecs::entity joint = world.entity()
+            .child_of(j == 0 ? player : joints[parents[j]])
+            .set<Transform>(rest)
+            .set<Joint>(Joint { .inverse_bind = glm::inverse(bind), .buffer_offset = JOINT_COUNT - 1 - j })
+            .set<AnimationTarget>(AnimationTarget { .joint_index = j, .rest = rest });
+        joints.push_back(joint);
+    }
+    bind_animation_targets(player);
+
+    return world.entity()
+        .child_of(player)
+        .set<SkinnedMesh>(SkinnedMesh { .joints = joints });
+}
+
+int main() {
+    flecs::world world{};
+    if (const auto res = initialize_vulkan(world, RendererDescriptor { .fallback_adapter = true }); res.is_err()) {
+        std::fprintf(stderr, "no fallback adapter to run on: VkResult %d\n", static_cast<int>(res.unwrap_err()));
+        return 1;
+    }
+    initialize_animation_plugin(world);
+    initialize_transform_plugin(world);
+
+    const flecs::entity clip = world.entity().emplace<PackedAnimationClip>(make_clip());
+    const flecs::entity gpu_mesh = spawn_character(world, clip, true);
+    const flecs::entity cpu_mesh = spawn_character(world, clip, false);
+
+    int result = 0;
+    for (const float seek_time: SEEK_TIMES) {
+        gpu_mesh.parent().get_mut<AnimationPlayer>()->seek(seek_time);
+        cpu_mesh.parent().get_mut<AnimationPlayer>()->seek(seek_time);
+        world.progress();
+
+        const std::vector<glm::mat4> gpu_palette = read_joint_palette(gpu_mesh);
+        const std::vector<glm::mat4> cpu_palette = read_joint_palette(cpu_mesh);
+        float max_error = 0.0f;
+        for (uint32_t j = 0; j < JOINT_COUNT; j++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                for (uint32_t r = 0; r < 4; r++) {
+                    max_error = std::max(max_error, std::abs(gpu_palette[j][c][r] - cpu_palette[j][c][r]));
+                }
+            }
+        }
+        std::printf("seek time %.2f: largest palette difference %g\n", seek_time, max_error);
+        if (max_error > MAX_ERROR) {
+            std::fprintf(stderr, "compute palette differs from the CPU palette at seek time %.2f\n", seek_time);
+            result = 1;
+        }
+    }
+
+    destroy_vulkan(world);
+    return result;
+}
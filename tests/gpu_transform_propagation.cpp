@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <glm/mat4x3.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include "ecs/ecs.hpp"
+
+import stellar.render.vulkan.plugin;
+import stellar.scene.transform;
+
+// Propagates a small hierarchy with TransformPropagationSettings { .gpu = true } on the fallback
+// adapter and checks transform_buffer against the CPU sweep, composing each local with
+// compose_affine onto its parent with multiply_affine. The second frame only moves one node in the
+// middle of the hierarchy, which must carry over to its descendants and leave the rest in place.
+constexpr float MAX_ERROR = 1e-3f;
+// Children per node on each level below the roots, so the hierarchy is four levels deep.
+constexpr uint32_t BRANCHING[] { 3, 2, 2 };
+constexpr uint32_t ROOT_COUNT = 2;
+
+struct Node {
+    flecs::entity entity;
+    uint32_t parent;
+};
+
+Transform make_local(const uint32_t index) {
+    const float f = static_cast<float>(index);
+    return Transform {
+        .translation = glm::vec3(0.5f * f, 1.0f, -0.25f * f),
+        .rotation = glm::angleAxis(0.3f + 0.1f * f, glm::normalize(glm::vec3(1.0f, f, 0.5f))),
+        .scale = glm::vec3(1.0f + 0.05f * f, 1.0f, 0.9f)
+    };
+}
+
+void spawn_children(const flecs::world& world, std::vector<Node>& nodes, const uint32_t parent, const uint32_t level) {
+    if (level >= std::size(BRANCHING)) return;
+    for (uint32_t c = 0; c < BRANCHING[level]; c++) {
+        const uint32_t index = nodes.size();
+        nodes.push_back(Node {
+            .entity = world.entity().child_of(nodes[parent].entity).set<Transform>(make_local(index)),
+            .parent = parent
+        });
+        spawn_children(world, nodes, index, level + 1);
+    }
+}
+
+// Nodes are spawned parents first, so one forward pass sees every parent before its children.
+float max_propagation_error(const flecs::world& world, const std::vector<Node>& nodes) {
+    const std::vector<glm::mat4x3> gpu_worlds = read_transform_buffer(world);
+    std::vector<glm::mat4x3> cpu_worlds(nodes.size());
+    float max_error = 0.0f;
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        const glm::mat4x3 local = compose_affine(*nodes[i].entity.get<Transform>());
+        cpu_worlds[i] = nodes[i].parent != NO_PARENT ? multiply_affine(cpu_worlds[nodes[i].parent], local) : local;
+
+        const glm::mat4x3& gpu_world = gpu_worlds[nodes[i].entity.get<HierarchyNode>()->index];
+        for (uint32_t c = 0; c < 4; c++) {
+            for (uint32_t r = 0; r < 3; r++) {
+                max_error = std::max(max_error, std::abs(gpu_world[c][r] - cpu_worlds[i][c][r]));
+            }
+        }
+    }
+    return max_error;
+}
+
+int main() {
+    flecs::world world{};
+    if (const auto res = initialize_vulkan(world, RendererDescriptor { .fallback_adapter = true }); res.is_err()) {
+        std::fprintf(stderr, "no fallback adapter to run on: VkResult %d\n", static_cast<int>(res.unwrap_err()));
+        return 1;
+    }
+    initialize_transform_plugin(world);
+    world.set<TransformPropagationSettings>({ .gpu = true });
+
+    std::vector<Node> nodes;
+    for (uint32_t r = 0; r < ROOT_COUNT; r++) {
+        const uint32_t index = nodes.size();
+        nodes.push_back(Node { .entity = world.entity().set<Transform>(make_local(index)), .parent = NO_PARENT });
+        spawn_children(world, nodes, index, 0);
+    }
+
+    int result = 0;
+    world.progress();
+    const float full_error = max_propagation_error(world, nodes);
+    std::printf("full upload: largest world matrix difference %g\n", full_error);
+    if (full_error > MAX_ERROR) {
+        std::fprintf(stderr, "GPU propagation differs from the CPU sweep after the first frame\n");
+        result = 1;
+    }
+
+    // The first child of the first root: level one, with two levels of descendants below it.
+    Transform* moved = nodes[1].entity.get_mut<Transform>();
+    moved->translation += glm::vec3(1.0f, -2.0f, 0.5f);
+    moved->rotation = glm::angleAxis(1.1f, glm::vec3(0.0f, 0.0f, 1.0f)) * moved->rotation;
+    world.progress();
+    const float partial_error = max_propagation_error(world, nodes);
+    std::printf("partial change: largest world matrix difference %g\n", partial_error);
+    if (partial_error > MAX_ERROR) {
+        std::fprintf(stderr, "GPU propagation differs from the CPU sweep after moving one mid-level node\n");
+        result = 1;
+    }
+
+    destroy_vulkan(world);
+    return result;
+}